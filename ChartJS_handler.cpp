@@ -20,23 +20,55 @@
 namespace corsim
 {
 
-ChartJSHandler::~ChartJSHandler(){}
+ChartJSHandler::ChartJSHandler(int flush_interval) : _flush_interval{flush_interval}
+{
+}
+
+ChartJSHandler::~ChartJSHandler()
+{
+    flush();
+}
 
 void ChartJSHandler::communicate_number_infected(int time, int infected)
 {
-    EM_ASM({
+    _infected.add(time, infected);
+    _dirty = true;
+
+    if(std::chrono::steady_clock::now() - _last_flush >= _flush_interval)
+    {
+        flush();
+    }
+}
+
+//
+// Replaces the labels and data of the chart with the points of the series, read straight from the WASM heap,
+// and redraws it once without animation
+//
+void ChartJSHandler::flush()
+{
+    if(!_dirty)
+    {
+        return;
+    }
+    _infected.points(_times, _values);
+    _dirty = false;
+    _last_flush = std::chrono::steady_clock::now();
+
+    // The chart lives on the page, a worker build hands the update to the main thread and waits for it
+    MAIN_THREAD_EM_ASM({
             var config = window.myConfig;
-            var myLine = window.myLine;
-            if (config.data.datasets.length > 0) {
-                    config.data.labels.push($0);
+            if (config && config.data.datasets.length > 0) {
+                    var times = HEAPF64.subarray($0 >> 3, ($0 >> 3) + $2);
+                    var values = HEAPF64.subarray($1 >> 3, ($1 >> 3) + $2);
+                    config.data.labels = Array.from(times);
 
                     config.data.datasets.forEach(function(dataset) {
-                        dataset.data.push($1);
+                        dataset.data = Array.from(values);
                     });
 
-                    window.myLine.update();
+                    window.myLine.update({duration: 0});
                 }
-            },time,infected);
+            }, _times.data(), _values.data(), _times.size());
 }
 
 }
\ No newline at end of file
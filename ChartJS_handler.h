@@ -17,6 +17,9 @@
 #pragma once
 
 #include "statistics_handler.h"
+#include "time_series.h"
+#include <chrono>
+#include <vector>
 
 namespace corsim
 {
@@ -24,12 +27,26 @@ namespace corsim
 /**
  * This class communicated statistics with a predefined instance of ChartJS
  * insde the DOM of the browser and webpage.
+ *
+ * Every redraw of the chart draws all of its points, so the numbers are collected in a TimeSeries
+ * of bounded size and handed to the chart at most once every flush_interval milliseconds, in one
+ * call that replaces the data of the chart. The samples after the last flush are handed over when
+ * the simulation finishes its run and calls flush.
  */
 class ChartJSHandler : public StatisticsHandler
 {
     public:
+    explicit ChartJSHandler(int flush_interval = 250);
     ~ChartJSHandler() override;
     void communicate_number_infected(int time, int infected) override;
+    void flush() override;
+
+    private:
+    TimeSeries _infected;
+    std::chrono::milliseconds _flush_interval;
+    std::chrono::steady_clock::time_point _last_flush;
+    bool _dirty = false; // samples were added since the last flush
+    std::vector<double> _times, _values;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,329 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+//
+// Headless benchmark of the simulation. Sweeps the population size, the lockdown fraction, the world size
+// and the subject radius one at a time around a baseline, and writes ticks per second, nanoseconds per
+// subject per tick and peak resident memory of every configuration as JSON.
+//
+// Every configuration runs in its own child process, so its peak memory is not hidden by the peak of an
+// earlier, larger configuration.
+//
+// Usage: corsim_bench [--counts 200,1000,...] [--lockdown 0,0.75,...] [--world-scales 0.5,1,...]
+//                     [--radii 1,2,...] [--baseline-count N] [--min-time SECONDS] [--threads N]
+//                     [--seed N] [--out FILE]
+//
+
+#include "../narrow_phase.h"
+#include "../null_canvas.h"
+#include "../scenario.h"
+#include "../simulation.h"
+#include "../null_statistics_handler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+struct Options
+{
+    std::vector<double> counts{200, 1000, 10000, 100000, 1000000};
+    std::vector<double> lockdown{0, 0.25, 0.5, 0.75, 1};
+    std::vector<double> world_scales{0.5, 1, 2, 4};
+    std::vector<double> radii{1, 2, 4, 8};
+    int baseline_count = 10000;
+    double min_time = 1.0; // seconds of ticks measured per configuration
+    unsigned threads = 0;
+    std::uint64_t seed = 42;
+    std::string out;
+};
+
+struct Config
+{
+    std::string sweep; // the parameter that is varied
+    corsim::Scenario scenario;
+    double world_scale;
+};
+
+struct Result
+{
+    int ticks = 0;
+    double seconds = 0;
+    double setup_seconds = 0;
+    long peak_rss_kb = 0;
+    bool ok = false;
+};
+
+const int TICKS_PER_FRAME = 10;
+const int WARMUP_TICKS = 10;
+
+std::vector<double> parse_list(const std::string& text)
+{
+    std::vector<double> values;
+    std::stringstream stream(text);
+    std::string value;
+    while(std::getline(stream, value, ','))
+    {
+        values.push_back(std::stod(value));
+    }
+    return values;
+}
+
+//
+// The world grows with the population so the density of the browser build (200 subjects on 800x500) is kept,
+// world_scale stretches both sides on top of that.
+//
+Config make_config(const std::string& sweep, int count, double lockdown, double world_scale, int radius)
+{
+    double side_scale = sqrt(count / 200.0) * world_scale;
+
+    Config config;
+    config.sweep = sweep;
+    config.world_scale = world_scale;
+    config.scenario.subject_count = count;
+    config.scenario.width = std::max(1, (int)round(800 * side_scale));
+    config.scenario.height = std::max(1, (int)round(500 * side_scale));
+    config.scenario.radius = radius;
+    config.scenario.lockdown_fraction = lockdown;
+    return config;
+}
+
+std::vector<Config> make_configs(const Options& options)
+{
+    corsim::Scenario defaults;
+    std::vector<Config> configs;
+    for(double count : options.counts)
+    {
+        configs.push_back(make_config("subject_count", (int)count, defaults.lockdown_fraction, 1, defaults.radius));
+    }
+    for(double lockdown : options.lockdown)
+    {
+        configs.push_back(make_config("lockdown_fraction", options.baseline_count, lockdown, 1, defaults.radius));
+    }
+    for(double scale : options.world_scales)
+    {
+        configs.push_back(make_config("world_scale", options.baseline_count, defaults.lockdown_fraction, scale, defaults.radius));
+    }
+    for(double radius : options.radii)
+    {
+        configs.push_back(make_config("radius", options.baseline_count, defaults.lockdown_fraction, 1, (int)radius));
+    }
+    return configs;
+}
+
+//
+// Runs in the child process: sets up the simulation and ticks it for at least min_time seconds
+//
+Result measure(const Config& config, const Options& options)
+{
+    using clock = std::chrono::steady_clock;
+    const corsim::Scenario& scenario = config.scenario;
+
+    auto setup_start = clock::now();
+    corsim::Simulation s(scenario.width, scenario.height, std::make_unique<corsim::NullCanvas>(),
+        std::make_unique<corsim::NullStatisticsHandler>());
+    corsim::Schedule schedule;
+    schedule.ticks_per_frame = TICKS_PER_FRAME;
+    s.set_schedule(schedule);
+    s.set_thread_count(options.threads);
+    s.set_seed(options.seed);
+    corsim::populate(s, scenario);
+    s.run(WARMUP_TICKS);
+
+    Result result;
+    result.setup_seconds = std::chrono::duration<double>(clock::now() - setup_start).count();
+
+    auto start = clock::now();
+    do
+    {
+        result.ticks += s.frame();
+        result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    while(result.seconds < options.min_time);
+
+    result.ok = true;
+    return result;
+}
+
+Result run_child(const Config& config, const Options& options)
+{
+    Result result;
+    int fds[2];
+    if(pipe(fds) != 0)
+    {
+        return result;
+    }
+
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        close(fds[0]);
+        Result measured = measure(config, options);
+        bool written = write(fds[1], &measured, sizeof(measured)) == (ssize_t)sizeof(measured);
+        _exit(written ? 0 : 1);
+    }
+
+    close(fds[1]);
+    if(pid > 0)
+    {
+        bool read_ok = read(fds[0], &result, sizeof(result)) == (ssize_t)sizeof(result);
+
+        int status = 0;
+        struct rusage usage;
+        if(wait4(pid, &status, 0, &usage) == pid && read_ok && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            result.peak_rss_kb = usage.ru_maxrss; // kilobytes on Linux
+        }
+        else
+        {
+            result.ok = false;
+        }
+    }
+    close(fds[0]);
+    return result;
+}
+
+void write_json(std::ostream& out, const Options& options, const std::vector<Config>& configs, const std::vector<Result>& results)
+{
+    out << "{\n  \"seed\": " << options.seed << ",\n  \"threads\": " << options.threads
+        << ",\n  \"min_time\": " << options.min_time
+        << ",\n  \"narrow_phase\": \"" << corsim::NARROW_PHASE_NAME << "\", \"narrow_phase_lanes\": " << corsim::NARROW_PHASE_LANES
+        << ",\n  \"results\": [";
+
+    for(std::size_t i = 0; i < configs.size(); i++)
+    {
+        const corsim::Scenario& scenario = configs[i].scenario;
+        const Result& r = results[i];
+        double ticks_per_second = r.seconds > 0 ? r.ticks / r.seconds : 0;
+        double ns_per_subject_tick = r.ticks > 0 ? r.seconds * 1e9 / ((double)r.ticks * scenario.subject_count) : 0;
+
+        out << (i == 0 ? "" : ",") << "\n    {\"sweep\": \"" << configs[i].sweep << "\""
+            << ", \"subject_count\": " << scenario.subject_count
+            << ", \"lockdown_fraction\": " << scenario.lockdown_fraction
+            << ", \"world_scale\": " << configs[i].world_scale
+            << ", \"width\": " << scenario.width << ", \"height\": " << scenario.height
+            << ", \"radius\": " << scenario.radius
+            << ", \"ok\": " << (r.ok ? "true" : "false")
+            << ", \"ticks\": " << r.ticks
+            << ", \"seconds\": " << r.seconds
+            << ", \"setup_seconds\": " << r.setup_seconds
+            << ", \"ticks_per_second\": " << ticks_per_second
+            << ", \"ns_per_subject_tick\": " << ns_per_subject_tick
+            << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for(int i = 1; i < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if(i + 1 == argc)
+        {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 1;
+        }
+
+        std::string value = argv[i + 1];
+        try
+        {
+            if(arg == "--counts")
+            {
+                options.counts = parse_list(value);
+            }
+            else if(arg == "--lockdown")
+            {
+                options.lockdown = parse_list(value);
+            }
+            else if(arg == "--world-scales")
+            {
+                options.world_scales = parse_list(value);
+            }
+            else if(arg == "--radii")
+            {
+                options.radii = parse_list(value);
+            }
+            else if(arg == "--baseline-count")
+            {
+                options.baseline_count = std::stoi(value);
+            }
+            else if(arg == "--min-time")
+            {
+                options.min_time = std::stod(value);
+            }
+            else if(arg == "--threads")
+            {
+                options.threads = std::stoi(value);
+            }
+            else if(arg == "--seed")
+            {
+                options.seed = std::stoull(value);
+            }
+            else if(arg == "--out")
+            {
+                options.out = value;
+            }
+            else
+            {
+                std::cerr << "Unknown argument " << arg << std::endl;
+                return 1;
+            }
+        }
+        catch(const std::logic_error&)
+        {
+            // std::invalid_argument or std::out_of_range from std::stoi and the like
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Config> configs = make_configs(options);
+    std::vector<Result> results;
+    std::cerr << "Narrow phase: " << corsim::NARROW_PHASE_NAME << ", " << corsim::NARROW_PHASE_LANES << " lanes" << std::endl;
+    for(const Config& config : configs)
+    {
+        std::cerr << config.sweep << ": " << config.scenario.subject_count << " subjects on " << config.scenario.width
+            << "x" << config.scenario.height << ", radius " << config.scenario.radius << ", lockdown "
+            << config.scenario.lockdown_fraction << "... " << std::flush;
+        results.push_back(run_child(config, options));
+        const Result& r = results.back();
+        std::cerr << (r.ok ? std::to_string((int)(r.ticks / r.seconds)) + " ticks/s" : std::string("failed")) << std::endl;
+    }
+
+    if(options.out.empty())
+    {
+        write_json(std::cout, options, configs, results);
+        return 0;
+    }
+
+    std::ofstream file(options.out);
+    write_json(file, options, configs, results);
+    return file ? 0 : 1;
+}
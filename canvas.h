@@ -32,6 +32,8 @@ enum CanvasColor
     YELLOW
 };
 
+const int CANVAS_COLOR_COUNT = YELLOW + 1;
+
 /**
  * The canvas interface describes that a canvas to draw the simulation on should be
  * able to do.
@@ -44,6 +46,7 @@ class Canvas
     virtual void draw_pixel(double x, double y, CanvasColor color) = 0;
     virtual void draw_rectangle(double x, double y, double width, double height, CanvasColor color) = 0;
     virtual void draw_ellipse(double x, double y, double radius, CanvasColor color) = 0;
+    virtual void present(){}; // called when everything of a frame has been drawn
 };
 
 }
\ No newline at end of file
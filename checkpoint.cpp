@@ -0,0 +1,156 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "checkpoint.h"
+#include <cstring>
+
+namespace corsim
+{
+
+namespace
+{
+
+const char CHECKPOINT_MAGIC[8] = {'C', 'O', 'R', 'S', 'I', 'M', 'C', 'P'};
+
+std::size_t aligned(std::size_t offset)
+{
+    return (offset + 7) & ~(std::size_t)7;
+}
+
+template<typename T>
+void write_column(const std::vector<T>& column, std::vector<char>& out)
+{
+    std::size_t offset = aligned(out.size());
+    out.resize(offset + column.size() * sizeof(T));
+    if(!column.empty())
+    {
+        std::memcpy(out.data() + offset, column.data(), column.size() * sizeof(T));
+    }
+}
+
+/**
+ * Reads the columns of a checkpoint one by one, failing when the data runs out
+ */
+class ColumnReader
+{
+    public:
+        ColumnReader(const char* data, std::size_t size, std::size_t offset) : _data{data}, _size{size}, _offset{offset} {}
+
+        template<typename T>
+        bool read(std::vector<T>& column, std::size_t count)
+        {
+            std::size_t offset = aligned(_offset);
+            if(offset > _size || (_size - offset) / sizeof(T) < count)
+            {
+                return false;
+            }
+            column.resize(count);
+            if(count > 0)
+            {
+                std::memcpy(column.data(), _data + offset, count * sizeof(T));
+            }
+            _offset = offset + count * sizeof(T);
+            return true;
+        }
+
+    private:
+        const char* _data;
+        std::size_t _size, _offset;
+};
+
+}
+
+bool write_checkpoint(const Population& p, const CheckpointHeader& header, std::vector<char>& out)
+{
+    if(!p.custom_strategies.empty())
+    {
+        return false;
+    }
+
+    CheckpointHeader h = header;
+    std::memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+    h.version = CHECKPOINT_VERSION;
+    h.byte_order = CHECKPOINT_BYTE_ORDER;
+    h.subject_count = p.size();
+    h.disease_count = p.diseases.size();
+    h.reserved = 0;
+
+    // Columns are aligned from the start of the checkpoint
+    std::vector<char> data(sizeof(h));
+    std::memcpy(data.data(), &h, sizeof(h));
+
+    write_column(p.x, data);
+    write_column(p.y, data);
+    write_column(p.dx, data);
+    write_column(p.dy, data);
+    write_column(p.radius, data);
+    write_column(p.state, data);
+    write_column(p.movement, data);
+    write_column(p.infection2immunity_start, data);
+    write_column(p.infection2immunity_end, data);
+    write_column(p.immunity_start, data);
+    write_column(p.immunity_end, data);
+    write_column(p.disease, data);
+    write_column(p.diseases, data);
+
+    out.insert(out.end(), data.begin(), data.end());
+    return true;
+}
+
+bool read_checkpoint(const char* data, std::size_t size, Population& population, CheckpointHeader& header)
+{
+    CheckpointHeader h;
+    if(size < sizeof(h))
+    {
+        return false;
+    }
+    std::memcpy(&h, data, sizeof(h));
+    if(std::memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 || h.version != CHECKPOINT_VERSION ||
+        h.byte_order != CHECKPOINT_BYTE_ORDER)
+    {
+        return false;
+    }
+
+    // Read into a new population first, so a truncated checkpoint leaves the current one alone
+    Population p;
+    std::size_t n = h.subject_count;
+    ColumnReader reader(data, size, sizeof(h));
+    bool ok = reader.read(p.x, n) && reader.read(p.y, n) && reader.read(p.dx, n) && reader.read(p.dy, n) &&
+        reader.read(p.radius, n) && reader.read(p.state, n) && reader.read(p.movement, n) &&
+        reader.read(p.infection2immunity_start, n) && reader.read(p.infection2immunity_end, n) &&
+        reader.read(p.immunity_start, n) && reader.read(p.immunity_end, n) &&
+        reader.read(p.disease, n) && reader.read(p.diseases, h.disease_count);
+    if(!ok)
+    {
+        return false;
+    }
+
+    for(std::size_t i = 0; i < n; i++)
+    {
+        if(p.disease[i] >= h.disease_count || p.movement[i] == MOVEMENT_CUSTOM)
+        {
+            return false;
+        }
+    }
+
+    population = std::move(p);
+    population.resize(n);
+    population.columns_changed(h.counter);
+    header = h;
+    return true;
+}
+
+}
@@ -0,0 +1,64 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "population.h"
+
+namespace corsim
+{
+
+/**
+ * Everything needed to continue a simulation exactly where it was: the population and the
+ * tick counter, seed and size of the simulation.
+ *
+ * The binary format is a CheckpointHeader followed by the columns of the population, one
+ * after the other in the order of write_checkpoint, every column starting at a multiple of
+ * 8 bytes. The data is in the byte order of the machine that wrote it, so a checkpoint file
+ * can be mapped into memory and its columns used in place.
+ */
+struct CheckpointHeader
+{
+    char magic[8];                // "CORSIMCP"
+    std::uint32_t version;
+    std::uint32_t byte_order;     // CHECKPOINT_BYTE_ORDER as written by the machine that saved it
+    std::uint64_t subject_count;
+    std::uint64_t disease_count;
+    std::uint64_t seed;
+    std::int32_t counter;
+    std::int32_t width, height;
+    std::uint32_t reserved;
+};
+
+const std::uint32_t CHECKPOINT_VERSION = 1;
+const std::uint32_t CHECKPOINT_BYTE_ORDER = 0x01020304;
+
+//
+// Appends the checkpoint to `out`. Custom movement strategies cannot be written, returns false
+// without writing anything when a subject has one.
+//
+bool write_checkpoint(const Population& population, const CheckpointHeader& header, std::vector<char>& out);
+
+//
+// Reads a checkpoint of `size` bytes at `data` into `population` and `header`. Returns false when it
+// is not a checkpoint of this version, population and header are only changed when it is.
+//
+bool read_checkpoint(const char* data, std::size_t size, Population& population, CheckpointHeader& header);
+
+}
@@ -0,0 +1,38 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+
+namespace corsim
+{
+
+/**
+ * B.3. the number of subjects in every compartment of the disease and A. movement states. A subject
+ * that is neither infected nor immune is susceptible. Immunity ends an infection, so normally every
+ * subject is in exactly one of susceptible, infected and immune, and in one of locked_down and moving.
+ */
+struct Compartments
+{
+    std::size_t susceptible = 0;
+    std::size_t infected = 0;
+    std::size_t immune = 0;
+    std::size_t locked_down = 0; // subjects whose movement strategy stands still
+    std::size_t moving = 0;
+};
+
+}
@@ -0,0 +1,62 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "csv_statistics_handler.h"
+#include <iostream>
+
+namespace corsim
+{
+
+CSVStatisticsHandler::CSVStatisticsHandler(const std::string& path) : _out{&std::cout}
+{
+    if(!path.empty())
+    {
+        _file.open(path);
+        if(_file)
+        {
+            _out = &_file;
+        }
+        else
+        {
+            std::cerr << "Could not open " << path << ", writing statistics to standard output" << std::endl;
+        }
+    }
+
+    *_out << "time,infected,susceptible,immune,locked_down,moving" << std::endl;
+}
+
+CSVStatisticsHandler::~CSVStatisticsHandler()
+{
+    _out->flush();
+}
+
+void CSVStatisticsHandler::flush()
+{
+    _out->flush();
+}
+
+void CSVStatisticsHandler::communicate_number_infected(int time, int infected)
+{
+    *_out << time << ',' << infected << ",,,,\n";
+}
+
+void CSVStatisticsHandler::communicate_compartments(int time, const Compartments& compartments)
+{
+    *_out << time << ',' << compartments.infected << ',' << compartments.susceptible << ',' << compartments.immune
+        << ',' << compartments.locked_down << ',' << compartments.moving << '\n';
+}
+
+}
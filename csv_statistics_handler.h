@@ -0,0 +1,45 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "statistics_handler.h"
+#include <fstream>
+#include <string>
+
+namespace corsim
+{
+
+/**
+ * This class writes the statistics of the simulation as CSV lines, either to
+ * standard output or, when a path is given, to a file. Every line has the time,
+ * the number of infected and the sizes of the other compartments.
+ */
+class CSVStatisticsHandler : public StatisticsHandler
+{
+    public:
+    CSVStatisticsHandler(const std::string& path = "");
+    ~CSVStatisticsHandler() override;
+    void communicate_number_infected(int time, int infected) override;
+    void communicate_compartments(int time, const Compartments& compartments) override;
+    void flush() override;
+
+    private:
+    std::ofstream _file;
+    std::ostream* _out;
+};
+
+}
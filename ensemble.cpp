@@ -0,0 +1,160 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ensemble.h"
+#include "null_canvas.h"
+#include "null_statistics_handler.h"
+#include "simulation.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <math.h>
+
+namespace corsim
+{
+
+namespace
+{
+
+const double QUANTILES[] = {0.05, 0.25, 0.5, 0.75, 0.95};
+
+//
+// Linear interpolation between the closest ranks of sorted `values`
+//
+double quantile(const std::vector<std::int32_t>& values, double q)
+{
+    double rank = q * (values.size() - 1);
+    std::size_t below = (std::size_t)floor(rank);
+    std::size_t above = std::min(below + 1, values.size() - 1);
+    return values[below] + (rank - below) * (values[above] - values[below]);
+}
+
+void write_summary(std::ostream& out, std::vector<std::int32_t>& values)
+{
+    double total = 0;
+    for(std::int32_t value : values)
+    {
+        total += value;
+    }
+    std::sort(values.begin(), values.end());
+
+    out << ',' << total / values.size();
+    for(double q : QUANTILES)
+    {
+        out << ',' << quantile(values, q);
+    }
+}
+
+}
+
+Ensemble::Ensemble(const EnsembleConfig& config) : _config{config}
+{
+    _config.tick_count = std::max(_config.tick_count, 0);
+}
+
+Ensemble::~Ensemble() = default;
+
+bool Ensemble::run(std::ostream& out)
+{
+    if(_config.runs < 1 || _config.stats_interval < 1)
+    {
+        return false;
+    }
+
+    out << "time,runs";
+    for(const char* count : {"infected", "immune"})
+    {
+        out << ',' << count << "_mean";
+        for(double q : QUANTILES)
+        {
+            int percent = (int)round(q * 100);
+            out << ',' << count << (percent < 10 ? "_p0" : "_p") << percent;
+        }
+    }
+    out << '\n';
+
+    const Scenario& scenario = _config.scenario;
+    Schedule schedule;
+    schedule.ticks_per_frame = _config.stats_interval;
+    schedule.stats_interval = _config.stats_interval;
+    schedule.draw = false;
+
+    std::size_t runs = _config.runs;
+    std::size_t slots = std::min<std::size_t>(std::max(_config.thread_count, 1u), runs);
+    int steps = (_config.tick_count + _config.stats_interval - 1) / _config.stats_interval;
+    _infected.assign(steps * runs, 0);
+    _immune.assign(steps * runs, 0);
+
+    ThreadPool pool(slots);
+    _simulations.resize(slots);
+    for(std::size_t first = 0; first < runs; first += slots)
+    {
+        std::size_t batch = std::min(slots, runs - first);
+        pool.run(batch, [&](std::size_t slot)
+        {
+            std::unique_ptr<Simulation>& s = _simulations[slot];
+            if(!s)
+            {
+                s = std::make_unique<Simulation>(scenario.width, scenario.height, std::make_unique<NullCanvas>(),
+                    std::make_unique<NullStatisticsHandler>());
+                s->set_schedule(schedule);
+            }
+            s->clear();
+            s->set_seed(_config.base_seed + first + slot);
+            populate(*s, scenario);
+        });
+
+        for(int step = 0; step < steps; step++)
+        {
+            int counter = std::min((step + 1) * _config.stats_interval, _config.tick_count);
+            pool.run(batch, [&](std::size_t slot)
+            {
+                Simulation& s = *_simulations[slot];
+                s.run(counter - s.counter());
+                _infected[step * runs + first + slot] = (std::int32_t)s.compartments().infected;
+                _immune[step * runs + first + slot] = (std::int32_t)s.compartments().immune;
+            });
+
+            // Every run has passed the step once the last batch has
+            if(first + batch == runs)
+            {
+                write_step(out, step, counter);
+            }
+        }
+    }
+
+    _simulations.clear();
+    out.flush();
+    return true;
+}
+
+//
+// Writes the row of step `step`, which ended on tick `counter`
+//
+void Ensemble::write_step(std::ostream& out, int step, int counter)
+{
+    int tick_speed = DiseaseParameters().tick_speed;
+    std::size_t runs = _config.runs;
+
+    // time in seconds of simulated time, as the statistics handler of a simulation gets it
+    out << counter / (1000 / tick_speed) << ',' << runs;
+    _values.assign(_infected.begin() + step * runs, _infected.begin() + (step + 1) * runs);
+    write_summary(out, _values);
+    _values.assign(_immune.begin() + step * runs, _immune.begin() + (step + 1) * runs);
+    write_summary(out, _values);
+    out << '\n';
+}
+
+}
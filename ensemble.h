@@ -0,0 +1,75 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "scenario.h"
+
+namespace corsim
+{
+
+class Simulation;
+
+/**
+ * The setup of an ensemble: `runs` simulations of the same scenario, run r seeded with
+ * base_seed + r, each running tick_count ticks. Statistics are taken every stats_interval ticks.
+ */
+struct EnsembleConfig
+{
+    Scenario scenario;
+    int runs = 100;
+    std::uint64_t base_seed = 1;
+    int tick_count = 3000;
+    int stats_interval = 30;
+    unsigned thread_count = 1;
+};
+
+/**
+ * Runs the simulations of an ensemble concurrently and writes, for every statistics step, the
+ * mean and quantiles over all runs of the number of infected and immune subjects as CSV.
+ *
+ * No more runs than there are threads are alive at once. They run in batches of thread_count,
+ * which advance in lockstep one step at a time, and every Simulation is cleared and reused for
+ * the next batch, so the memory of the runs stays that of thread_count simulations. Only the
+ * counts of every run at every step are kept, the rows are written step by step while the last
+ * batch runs. A tick_count that is not a multiple of stats_interval ends with a shorter step.
+ */
+class Ensemble
+{
+    public:
+        explicit Ensemble(const EnsembleConfig& config);
+        ~Ensemble();
+
+        //
+        // Returns false without running anything when the config has no runs or a stats_interval below 1
+        //
+        bool run(std::ostream& out);
+
+    private:
+        void write_step(std::ostream& out, int step, int counter);
+
+        EnsembleConfig _config;
+        std::vector<std::unique_ptr<Simulation>> _simulations; // one per thread, reused for every batch
+        std::vector<std::int32_t> _infected, _immune;          // by step, then run
+        std::vector<std::int32_t> _values;
+};
+
+}
@@ -59,12 +59,11 @@ std::string canvas_color_to_string(CanvasColor c)
     }
 }
 
-HTMLCanvas::HTMLCanvas(int x, int y, int width, int height)
+//
+// Adds a canvas element to the page and makes its 2D context available as window[id]
+//
+void create_canvas_element(const std::string& id, int x, int y, int width, int height)
 {
-    this->_canvas_id = generate_unique_name();
-    this->_width = width;
-    this->_height = height;
-
     EM_ASM({
         var canvas = document.createElement('canvas');
         canvas.id = Module.AsciiToString($0);
@@ -78,7 +77,16 @@ HTMLCanvas::HTMLCanvas(int x, int y, int width, int height)
         document.body.append(canvas);
         var context = canvas.getContext('2d');
         window[canvas.id] = context;
-    }, this->_canvas_id.c_str(), x, y, width, height);
+    }, id.c_str(), x, y, width, height);
+}
+
+HTMLCanvas::HTMLCanvas(int x, int y, int width, int height)
+{
+    this->_canvas_id = generate_unique_name();
+    this->_width = width;
+    this->_height = height;
+
+    create_canvas_element(_canvas_id, x, y, width, height);
 }
 
 HTMLCanvas::~HTMLCanvas(){std::cout << "HTML Canvas destroyed" << std::endl; }
@@ -116,4 +124,110 @@ void HTMLCanvas::draw_ellipse(double x, double y, double radius, CanvasColor col
     }, _canvas_id.c_str(),canvas_color_to_string(color).c_str(),x, y, radius);
 }
 
-}
\ No newline at end of file
+BatchedHTMLCanvas::BatchedHTMLCanvas(int x, int y, int width, int height) : HTMLCanvas(x, y, width, height)
+{
+    // The colour names are handed to JavaScript once instead of with every draw call
+    for(int c = 0; c < CANVAS_COLOR_COUNT; c++)
+    {
+        EM_ASM({
+            window.corsimColors = window.corsimColors || [];
+            window.corsimColors[$0] = Module.AsciiToString($1);
+        }, c, canvas_color_to_string((CanvasColor)c).c_str());
+    }
+}
+
+void BatchedHTMLCanvas::clear()
+{
+    for(int c : _color_order)
+    {
+        _rectangles[c].clear();
+        _ellipses[c].clear();
+    }
+    _color_order.clear();
+}
+
+void BatchedHTMLCanvas::use_color(CanvasColor color)
+{
+    if(_rectangles[color].empty() && _ellipses[color].empty())
+    {
+        _color_order.push_back(color);
+    }
+}
+
+void BatchedHTMLCanvas::draw_pixel(double x, double y, CanvasColor color)
+{
+    this->draw_rectangle(x, y, 1, 1, color);
+}
+
+void BatchedHTMLCanvas::draw_rectangle(double x, double y, double width, double height, CanvasColor color)
+{
+    use_color(color);
+    _rectangles[color].insert(_rectangles[color].end(), {x, y, width, height});
+}
+
+void BatchedHTMLCanvas::draw_ellipse(double x, double y, double radius, CanvasColor color)
+{
+    use_color(color);
+    _ellipses[color].insert(_ellipses[color].end(), {x, y, radius});
+}
+
+void BatchedHTMLCanvas::present()
+{
+    _header.clear();
+    _commands.clear();
+    _header.push_back(_color_order.size());
+
+    for(int c : _color_order)
+    {
+        _header.push_back(c);
+        _header.push_back(_rectangles[c].size() / 4);
+        _header.push_back(_ellipses[c].size() / 3);
+        _commands.insert(_commands.end(), _rectangles[c].begin(), _rectangles[c].end());
+        _commands.insert(_commands.end(), _ellipses[c].begin(), _ellipses[c].end());
+    }
+
+    EM_ASM({
+        var context = window[Module.AsciiToString($0)];
+        var header = $3 >> 2;
+        var command = $4 >> 3;
+        context.clearRect(0, 0, $1, $2);
+
+        var groups = HEAP32[header++];
+        for (var g = 0; g < groups; g++) {
+            context.fillStyle = window.corsimColors[HEAP32[header++]];
+            var rectangles = HEAP32[header++];
+            var ellipses = HEAP32[header++];
+
+            for (var r = 0; r < rectangles; r++, command += 4) {
+                context.fillRect(HEAPF64[command], HEAPF64[command + 1], HEAPF64[command + 2], HEAPF64[command + 3]);
+            }
+
+            if (ellipses > 0) {
+                context.beginPath();
+                for (var e = 0; e < ellipses; e++, command += 3) {
+                    var x = HEAPF64[command], y = HEAPF64[command + 1], radius = HEAPF64[command + 2];
+                    context.moveTo(x + radius, y);
+                    context.arc(x, y, radius, 0, Math.PI * 2);
+                }
+                context.fill();
+            }
+        }
+    }, _canvas_id.c_str(), _width, _height, _header.data(), _commands.data());
+}
+
+HTMLRasterCanvas::HTMLRasterCanvas(int x, int y, int width, int height) : RasterCanvas(width, height)
+{
+    this->_canvas_id = generate_unique_name();
+    create_canvas_element(_canvas_id, x, y, width, height);
+}
+
+void HTMLRasterCanvas::present()
+{
+    EM_ASM({
+        var context = window[Module.AsciiToString($0)];
+        var pixels = new Uint8ClampedArray(HEAPU8.buffer, $1, $2 * $3 * 4);
+        context.putImageData(new ImageData(pixels, $2, $3), 0, 0);
+    }, _canvas_id.c_str(), pixels(), _width, _height);
+}
+
+}
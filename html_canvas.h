@@ -17,7 +17,9 @@
 #pragma once
 
 #include "canvas.h"
+#include "raster_canvas.h"
 #include <string>
+#include <vector>
 
 namespace corsim
 {
@@ -36,9 +38,53 @@ class HTMLCanvas : public Canvas
     void draw_rectangle(double x, double y, double width, double height, CanvasColor color) override;
     void draw_ellipse(double x, double y, double radius, CanvasColor color) override;
 
-    private:
+    protected:
     std::string _canvas_id;
     int _width, _height;
 };
 
-}
\ No newline at end of file
+/**
+ * A HTMLCanvas that does not draw right away but records the draw calls of a frame in
+ * a buffer in WASM memory. When the frame is presented, a single call into JavaScript
+ * reads the buffer straight from the heap and replays it grouped by colour: one
+ * fillStyle change and one path per colour. Colours are replayed in the order they
+ * were first used in the frame.
+ */
+class BatchedHTMLCanvas : public HTMLCanvas
+{
+   public:
+    BatchedHTMLCanvas(int x, int y, int width, int height);
+    void clear() override;
+    void draw_pixel(double x, double y, CanvasColor color) override;
+    void draw_rectangle(double x, double y, double width, double height, CanvasColor color) override;
+    void draw_ellipse(double x, double y, double radius, CanvasColor color) override;
+    void present() override;
+
+    private:
+    void use_color(CanvasColor color);
+
+    std::vector<double> _rectangles[CANVAS_COLOR_COUNT]; // x, y, width, height
+    std::vector<double> _ellipses[CANVAS_COLOR_COUNT];   // x, y, radius
+    std::vector<int> _color_order;                       // colours in order of first use this frame
+
+    // Packed frame: _header holds the group count and per group the colour, rectangle and ellipse
+    // count, _commands holds the rectangles and then the ellipses of every group
+    std::vector<int> _header;
+    std::vector<double> _commands;
+};
+
+/**
+ * A RasterCanvas shown on the web page. Every frame is rasterised in WASM memory and
+ * copied to the page's canvas with a single putImageData call.
+ */
+class HTMLRasterCanvas : public RasterCanvas
+{
+   public:
+    HTMLRasterCanvas(int x, int y, int width, int height);
+    void present() override;
+
+    private:
+    std::string _canvas_id;
+};
+
+}
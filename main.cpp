@@ -14,122 +14,457 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-#include "MovementStrategy/MovementStrategyInterface.h"
-#include "MovementStrategy/LockdownMovementStrategy.h"
-#include "MovementStrategy/RegularMovementStrategy.h"
-
-
 #include "simulation.h"
+#include "null_canvas.h"
+#include "scenario.h"
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <random>
-#include <math.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#ifdef __EMSCRIPTEN__
 #include "html_canvas.h"
 #include "ChartJS_handler.h"
+#else
+#include "ensemble.h"
+#include "record_reader.h"
+#include "raster_canvas.h"
+#include "sweep.h"
+#include "csv_statistics_handler.h"
+#endif
 
 //Constants to control the simulation
 const int SUBJECT_COUNT = 200;
 const int SIM_WIDTH = 800;
 const int SIM_HEIGHT = 500;
 const int SUBJECT_RADIUS = 2;
+const double LOCKDOWN_FRACTION = 0.75; // 75% are locked
+const int TICKS_PER_FRAME = 1; // 0 runs the simulation as fast as possible, still drawing 30 frames per second
 
-int main() {
-
+#ifndef __EMSCRIPTEN__
+//
+// Runs `s` along with the recording at `path` and checks that every recorded tick decodes to the positions and
+// states of the simulation, and that the events of a tick happened since the previous one
+//
+bool verify_recording(corsim::Simulation& s, const std::string& path)
+{
+    corsim::RecordReader reader(path);
+    corsim::RecordedFrame frame;
+    int frames = 0, previous_tick = s.counter();
+    while(reader.next(frame))
+    {
+        if(frame.tick <= s.counter())
+        {
+            std::cerr << "Recorded tick " << frame.tick << " is not after tick " << s.counter() << std::endl;
+            return false;
+        }
+        s.run(frame.tick - s.counter());
 
-    // ////////////////////////////////////////////////////////////
-    // B.3. preper immunity periods parameters
-    //
-    std::shared_ptr<const int> infection2immunityDuration;
-    std::shared_ptr<const int> immunityDurationShPtr;
-    std::shared_ptr<const int> tick_speedShPtr;
-    //const int tick_speed = 1000/30;
-    //const int immunityDuration = 4 * tick_speed;
+        const corsim::Population& p = s.population();
+        bool same = frame.x.size() == p.size();
+        for(std::size_t i = 0; i < p.size() && same; i++)
+        {
+            same = frame.x[i] == (std::int32_t)lround(p.x[i] * reader.position_scale()) &&
+                frame.y[i] == (std::int32_t)lround(p.y[i] * reader.position_scale()) && frame.state[i] == p.state[i];
+        }
+        for(const corsim::SubjectEvent& event : frame.events)
+        {
+            same = same && event.tick > previous_tick && event.tick <= frame.tick && event.subject < p.size();
+        }
+        if(!same)
+        {
+            std::cerr << "Recorded tick " << frame.tick << " does not match the simulation" << std::endl;
+            return false;
+        }
+        previous_tick = frame.tick;
+        frames++;
+    }
 
-    tick_speedShPtr = std::make_shared<const int>(1000/30);
-    infection2immunityDuration= std::make_shared<const int>(90 * (*(tick_speedShPtr.get())));
-    immunityDurationShPtr = std::make_shared<const int>(210 * (*(tick_speedShPtr.get())));
-    // END: B.3. preper immunity periods parameters
-    // ////////////////////////////////////////////////////////////
+    if(!reader.good())
+    {
+        std::cerr << "Could not decode " << path << " after " << frames << " ticks" << std::endl;
+        return false;
+    }
+    std::cerr << "All " << frames << " recorded ticks match the simulation" << std::endl;
+    return true;
+}
+#endif
 
-    corsim::Simulation s(SIM_WIDTH,SIM_HEIGHT,std::make_unique<corsim::HTMLCanvas>(30,150,SIM_WIDTH,SIM_HEIGHT),
-        std::make_unique<corsim::ChartJSHandler>());
+int main(int argc, char** argv) {
 
-    //Code to randomly generate certain numbers, which is done by using certain distributions
+    // Native builds are headless batch runs: --ticks sets the run length, --threads the number of threads
+    // for a parallel tick, --seed the seed of the run, --csv writes the statistics to a file and --frames
+    // writes every frame to a directory as a PPM image. --ticks-per-frame sets how many ticks run per drawn frame,
+    // 0 for uncapped with a frame drawn every --frame-interval milliseconds. Builds with CORSIM_PROFILE defined
+    // print a per phase summary at the end and write a Chrome trace to the file given with --profile.
+    // --load-checkpoint continues a run saved with --save-checkpoint instead of setting up a new population,
+    // --record streams the positions, states and disease events of every tick to a file, --verify-record runs the
+    // simulation set up by the other options along with such a file and fails when they differ. --ensemble runs that many
+    // simulations on --threads threads instead, seeded from --seed on, and writes the mean and quantiles of the
+    // number of infected and immune subjects over all runs to --csv. --sweep NAME=V1,V2,... varies a parameter of
+    // the scenario instead, see sweep.h, and can be given for several parameters. --design grid runs every
+    // combination, --design lhs --samples N a Latin hypercube of N points within the ranges of the values. Every
+    // point is run --replicates times, the lockdown and immunity periods of a point start after --warmup ticks.
+    // --collision trig|vector|compare picks the collision response, compare prints how far vector is off trig and
+    // fails when that is more than --collision-tolerance.
+    // --broad-phase grid|brute picks how collision candidates are found, brute tests every pair and gives the same
+    // result as grid, the default, without --threads.
+    // --infection-radius infects within that distance of an infected subject instead of on collision, with the chance
+    // per tick given by --transmission-probability
+    int tick_count = -1;
+    corsim::Schedule schedule;
+    schedule.ticks_per_frame = TICKS_PER_FRAME;
+    unsigned thread_count = 0;
+    std::string csv_path;
+    std::string frame_directory;
+    std::string profile_path;
+    std::string load_path, save_path;
+    std::string record_path;
+    corsim::CollisionResponse collision_response = corsim::CollisionResponse::Trigonometric;
+    double collision_tolerance = 1e-9;
+    corsim::BroadPhase broad_phase = corsim::BroadPhase::UniformGrid;
+    double infection_radius = 0;
+    double transmission_probability = 1;
+    // Without a given seed every run is different, the seed is printed so the run can be reproduced
     std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_real_distribution<double> dist_w(1.0, SIM_WIDTH);
-    std::uniform_real_distribution<double> dist_h(1.0, SIM_HEIGHT);
-    std::uniform_real_distribution<double> dist_dx(-1.0, 1.0);
-    std::uniform_real_distribution<double> dist_dy(-1.0, 1.0);
-
-    /*std::uniform_real_distribution<double> dist_random_select(0.0, 1.0);
-    int RandomSelectionIndex[SUBJECT_COUNT];
-    for (int i = 0; i<SUBJECT_COUNT; ++i)
-    {
-       RandomSelectionIndex[ i ] = -1;
-    }*/
-
-    int limitLockDown = (int)std::floor(SUBJECT_COUNT * 0.75 ); // 75% are locked
-    for (int i = 0; i<SUBJECT_COUNT; ++i)
+    std::uint64_t seed = ((std::uint64_t)rd() << 32) | rd();
+#ifndef __EMSCRIPTEN__
+    tick_count = 3000;
+    int ensemble_runs = 0;
+    std::string verify_path;
+    corsim::SweepConfig sweep;
+    for (int i = 1; i < argc; i += 2)
     {
-        // -------------------------------------------------------------------------
-        // linear hash collision conflict resolution
-        /*int trajectionIndex = (int)(dist_random_select(mt) * (double)SUBJECT_COUNT);
-        bool isHit = false;
-        do
+        std::string arg = argv[i];
+        try
         {
-             if( RandomSelectionIndex[trajectionIndex] != -1 )
-             {
-                isHit = false;
-                if(trajectionIndex < (SUBJECT_COUNT - 2))
+            if (i + 1 == argc)
+            {
+                std::cerr << "Missing value for " << arg << std::endl;
+                return 1;
+            }
+            else if (arg == "--ticks")
+            {
+                tick_count = std::stoi(argv[i + 1]);
+            }
+            else if (arg == "--threads")
+            {
+                thread_count = std::stoi(argv[i + 1]);
+            }
+            else if (arg == "--seed")
+            {
+                seed = std::stoull(argv[i + 1]);
+            }
+            else if (arg == "--ticks-per-frame")
+            {
+                schedule.ticks_per_frame = std::stoi(argv[i + 1]);
+                if (schedule.ticks_per_frame < 0)
+                {
+                    std::cerr << "--ticks-per-frame cannot be negative" << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--frame-interval")
+            {
+                schedule.frame_interval = std::stoi(argv[i + 1]);
+                if (schedule.frame_interval < 0)
+                {
+                    std::cerr << "--frame-interval cannot be negative" << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--load-checkpoint")
+            {
+                load_path = argv[i + 1];
+            }
+            else if (arg == "--save-checkpoint")
+            {
+                save_path = argv[i + 1];
+            }
+            else if (arg == "--record")
+            {
+                record_path = argv[i + 1];
+            }
+            else if (arg == "--verify-record")
+            {
+                verify_path = argv[i + 1];
+            }
+            else if (arg == "--ensemble")
+            {
+                ensemble_runs = std::stoi(argv[i + 1]);
+            }
+            else if (arg == "--sweep")
+            {
+                std::string factor = argv[i + 1];
+                std::size_t equals = factor.find('=');
+                corsim::SweepFactor sweep_factor;
+                if (equals == std::string::npos || !corsim::parse_sweep_parameter(factor.substr(0, equals), sweep_factor.parameter))
+                {
+                    std::cerr << "Unknown sweep parameter " << factor << std::endl;
+                    return 1;
+                }
+                for (std::size_t start = equals + 1; start <= factor.size();)
+                {
+                    std::size_t end = std::min(factor.find(',', start), factor.size());
+                    sweep_factor.values.push_back(std::stod(factor.substr(start, end - start)));
+                    start = end + 1;
+                }
+                sweep.factors.push_back(sweep_factor);
+            }
+            else if (arg == "--design")
+            {
+                std::string design = argv[i + 1];
+                if (design != "grid" && design != "lhs")
+                {
+                    std::cerr << "Unknown design " << design << std::endl;
+                    return 1;
+                }
+                sweep.design = design == "grid" ? corsim::SweepDesign::Grid : corsim::SweepDesign::LatinHypercube;
+            }
+            else if (arg == "--samples")
+            {
+                sweep.samples = std::stoi(argv[i + 1]);
+            }
+            else if (arg == "--replicates")
+            {
+                sweep.replicates = std::stoi(argv[i + 1]);
+            }
+            else if (arg == "--warmup")
+            {
+                sweep.warmup_ticks = std::stoi(argv[i + 1]);
+            }
+            else if (arg == "--collision")
+            {
+                std::string response = argv[i + 1];
+                if (response == "trig")
+                {
+                    collision_response = corsim::CollisionResponse::Trigonometric;
+                }
+                else if (response == "vector")
+                {
+                    collision_response = corsim::CollisionResponse::Vector;
+                }
+                else if (response == "compare")
+                {
+                    collision_response = corsim::CollisionResponse::Compare;
+                }
+                else
+                {
+                    std::cerr << "Unknown collision response " << response << std::endl;
+                    return 1;
+                }
+            }
+            else if (arg == "--broad-phase")
+            {
+                std::string phase = argv[i + 1];
+                if (phase == "grid")
                 {
-                   trajectionIndex++;
+                    broad_phase = corsim::BroadPhase::UniformGrid;
+                }
+                else if (phase == "brute")
+                {
+                    broad_phase = corsim::BroadPhase::BruteForce;
                 }
                 else
                 {
-                   trajectionIndex  = 0; // wrap arround
+                    std::cerr << "Unknown broad phase " << phase << std::endl;
+                    return 1;
                 }
-             }
-             else // hit an enpty cell
-             {
-                RandomSelectionIndex[trajectionIndex] = i;
-                isHit = true;
-             }
+            }
+            else if (arg == "--collision-tolerance")
+            {
+                collision_tolerance = std::stod(argv[i + 1]);
+            }
+            else if (arg == "--infection-radius")
+            {
+                infection_radius = std::stod(argv[i + 1]);
+            }
+            else if (arg == "--transmission-probability")
+            {
+                transmission_probability = std::stod(argv[i + 1]);
+            }
+            else if (arg == "--profile")
+            {
+                profile_path = argv[i + 1];
+            }
+            else if (arg == "--frames")
+            {
+                frame_directory = argv[i + 1];
+            }
+            else if (arg == "--csv")
+            {
+                csv_path = argv[i + 1];
+            }
+            else
+            {
+                std::cerr << "Unknown argument " << arg << std::endl;
+                return 1;
+            }
+        }
+        catch (const std::logic_error&)
+        {
+            // std::invalid_argument or std::out_of_range from std::stoi and the like
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 1;
         }
-        while( !isHit );*/
-        
+    }
+#endif
 
-     
-        // -------------------------------------------------------------------------
+    corsim::Scenario scenario;
+    scenario.subject_count = SUBJECT_COUNT;
+    scenario.width = SIM_WIDTH;
+    scenario.height = SIM_HEIGHT;
+    scenario.radius = SUBJECT_RADIUS;
+    scenario.lockdown_fraction = LOCKDOWN_FRACTION;
 
-        double x = dist_w(mt); //Randomly generate x position
-        double y = dist_h(mt); //Randomly generate y position
-        
-        corsim::Subject su(x,y,SUBJECT_RADIUS,false,infection2immunityDuration ,immunityDurationShPtr,tick_speedShPtr);
+#ifndef __EMSCRIPTEN__
+    bool sweeping = !sweep.factors.empty() || sweep.design == corsim::SweepDesign::LatinHypercube;
+    if (ensemble_runs > 0 || sweeping)
+    {
+        unsigned batch_threads = thread_count > 0 ? thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+        std::cerr << "Seed: " << seed << std::endl;
+
+        std::ofstream file;
+        if (!csv_path.empty())
+        {
+            file.open(csv_path);
+            if (!file)
+            {
+                std::cerr << "Could not write " << csv_path << std::endl;
+                return 1;
+            }
+        }
+        std::ostream& out = csv_path.empty() ? std::cout : file;
 
-        su.set_dx(dist_dx(mt));
-        su.set_dy(dist_dy(mt));
+        if (sweeping)
+        {
+            sweep.scenario = scenario;
+            sweep.base_seed = seed;
+            sweep.tick_count = tick_count;
+            sweep.check_interval = schedule.stats_interval;
+            sweep.thread_count = batch_threads;
+            if (!corsim::Sweep(sweep).run(out))
+            {
+                std::cerr << "Some runs could not continue from their warm-up, see the failed column" << std::endl;
+                return 1;
+            }
+            return 0;
+        }
 
-        if(i == SUBJECT_COUNT-1)
+        corsim::EnsembleConfig config;
+        config.scenario = scenario;
+        config.runs = ensemble_runs;
+        config.base_seed = seed;
+        config.tick_count = tick_count;
+        config.stats_interval = schedule.stats_interval;
+        config.thread_count = batch_threads;
+        if (!corsim::Ensemble(config).run(out))
         {
-            su.infect();
-            su.StartInfection2immunityPeriodOn(0); // first subject infected on simukation time 0
+            std::cerr << "An ensemble needs at least one run and a statistics interval of at least one tick" << std::endl;
+            return 1;
         }
+        return 0;
+    }
+#endif
+
+#if defined(__EMSCRIPTEN__) && defined(CORSIM_WORKER)
+    // The simulation runs in a worker that cannot touch the page, the page draws what the publisher shares
+    corsim::Simulation s(SIM_WIDTH,SIM_HEIGHT,std::make_unique<corsim::NullCanvas>(),
+        std::make_unique<corsim::ChartJSHandler>());
+    s.set_publisher(std::make_unique<corsim::StatePublisher>(SIM_WIDTH,SIM_HEIGHT));
+#elif defined(__EMSCRIPTEN__) && defined(CORSIM_RASTER_CANVAS)
+    // Rasterised in WASM memory and copied to the page with one putImageData per frame, for large populations
+    corsim::Simulation s(SIM_WIDTH,SIM_HEIGHT,std::make_unique<corsim::HTMLRasterCanvas>(30,150,SIM_WIDTH,SIM_HEIGHT),
+        std::make_unique<corsim::ChartJSHandler>());
+#elif defined(__EMSCRIPTEN__)
+    corsim::Simulation s(SIM_WIDTH,SIM_HEIGHT,std::make_unique<corsim::BatchedHTMLCanvas>(30,150,SIM_WIDTH,SIM_HEIGHT),
+        std::make_unique<corsim::ChartJSHandler>());
+#else
+    std::unique_ptr<corsim::Canvas> canvas = std::make_unique<corsim::NullCanvas>();
+    if (!frame_directory.empty())
+    {
+        auto raster = std::make_unique<corsim::RasterCanvas>(SIM_WIDTH,SIM_HEIGHT);
+        raster->set_frame_output(frame_directory);
+        canvas = std::move(raster);
+    }
+    corsim::Simulation s(SIM_WIDTH,SIM_HEIGHT,std::move(canvas),
+        std::make_unique<corsim::CSVStatisticsHandler>(csv_path));
+#endif
+    s.set_thread_count(thread_count);
+    s.set_schedule(schedule);
+    s.set_collision_response(collision_response);
+    s.set_broad_phase(broad_phase);
+    s.set_infection_radius(infection_radius);
+    s.set_transmission_probability(transmission_probability);
+    s.set_seed(seed);
+
+    if (load_path.empty())
+    {
+        corsim::populate(s, scenario);
+    }
+    else if (!s.load_checkpoint(load_path))
+    {
+        std::cerr << "Could not load " << load_path << std::endl;
+        return 1;
+    }
+    std::cerr << "Seed: " << s.rng().seed() << std::endl;
 
-        if( i < limitLockDown )
+    if (!record_path.empty())
+    {
+        auto recorder = std::make_unique<corsim::Recorder>(record_path);
+        if (!recorder->good())
         {
-           // A. instantiate strategy
-           su._movementStrategy = std::make_shared< MovementStrategyInterface* >(new LockdownMovement());
-           //std::cout << "\n ("<<limitLockDown<<"/"<<SUBJECT_COUNT<<") lockdown["<< i <<"]: " << su.isStandStill()<<"\n";
+            std::cerr << "Could not write " << record_path << std::endl;
+            return 1;
         }
-        else
+        s.set_recorder(std::move(recorder));
+    }
+
+#ifndef __EMSCRIPTEN__
+    if (!verify_path.empty())
+    {
+        return verify_recording(s, verify_path) ? 0 : 1;
+    }
+#endif
+
+#if defined(__EMSCRIPTEN__) && !defined(CORSIM_ASYNCIFY) && !defined(CORSIM_WORKER)
+    // Without ASYNCIFY the simulation cannot sleep to let the browser draw, the browser runs the frames instead
+    s.run_in_main_loop(tick_count);
+#else
+    s.run(tick_count);
+#endif
+
+    if (!s.finish_recording())
+    {
+        std::cerr << "Could not write all of " << record_path << std::endl;
+        return 1;
+    }
+
+    if (collision_response == corsim::CollisionResponse::Compare)
+    {
+        std::cerr << "Largest difference between the trig and vector collision response: "
+            << s.collision_response_deviation() << std::endl;
+        if (s.collision_response_deviation() > collision_tolerance)
         {
-           // A. instantiate strategy
-           su._movementStrategy = std::make_shared< MovementStrategyInterface* >(new RegularMovement());
-           //std::cout << "\n ("<<limitLockDown<<"/"<<SUBJECT_COUNT<<") lockdown["<< i <<"]: " << su.isStandStill()<<"\n";
+            std::cerr << "The difference is more than the tolerance of " << collision_tolerance << std::endl;
+            return 1;
         }
+    }
 
-        s.add_subject(std::move(su));
-    }  
+    if (!save_path.empty() && !s.save_checkpoint(save_path))
+    {
+        std::cerr << "Could not save " << save_path << std::endl;
+        return 1;
+    }
 
-    s.run();
+#if defined(CORSIM_PROFILE) && !defined(__EMSCRIPTEN__)
+    corsim::Profiler::instance().write_summary(std::cerr);
+    if (!profile_path.empty() && !corsim::Profiler::instance().write_trace(profile_path))
+    {
+        std::cerr << "Could not write " << profile_path << std::endl;
+    }
+#endif
 }
@@ -0,0 +1,205 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "narrow_phase.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace corsim
+{
+
+namespace
+{
+
+// Relative slack on the squared sum of the radii, far above the rounding error of a squared distance
+const double SLACK = 1 + 1e-9;
+
+bool may_overlap(const Population& p, double x, double y, int radius, std::size_t j)
+{
+    double dx = p.x[j] - x;
+    double dy = p.y[j] - y;
+    double r = radius + p.radius[j];
+    return dx * dx + dy * dy < r * r * SLACK;
+}
+
+#if defined(__AVX2__)
+
+static_assert(sizeof(std::size_t) == sizeof(long long), "candidates are gathered as 64 bit indices");
+
+//
+// Bit k is set when candidates[k] may overlap, for the four candidates at `candidates`
+//
+class Lanes
+{
+    public:
+        Lanes(double x, double y, int radius) :
+            _x{_mm256_set1_pd(x)}, _y{_mm256_set1_pd(y)}, _radius{_mm_set1_epi32(radius)}, _slack{_mm256_set1_pd(SLACK)} {}
+
+        unsigned overlaps(const Population& p, const std::size_t* candidates) const
+        {
+            __m256i index = _mm256_loadu_si256((const __m256i*)candidates);
+            __m256d dx = _mm256_sub_pd(_mm256_i64gather_pd(p.x.data(), index, 8), _x);
+            __m256d dy = _mm256_sub_pd(_mm256_i64gather_pd(p.y.data(), index, 8), _y);
+            __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+
+            __m128i radii = _mm_add_epi32(_mm256_i64gather_epi32(p.radius.data(), index, 4), _radius);
+            __m256d r = _mm256_cvtepi32_pd(radii);
+            __m256d limit = _mm256_mul_pd(_mm256_mul_pd(r, r), _slack);
+
+            return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(d2, limit, _CMP_LT_OQ));
+        }
+
+    private:
+        __m256d _x, _y;
+        __m128i _radius;
+        __m256d _slack;
+};
+
+const std::size_t LANES = 4;
+const char* const NAME = "avx2";
+
+#elif defined(__wasm_simd128__)
+
+//
+// Same as the AVX2 version with two lanes of 64 bit doubles per vector. WASM has no gather, the lanes are
+// loaded one by one.
+//
+class Lanes
+{
+    public:
+        Lanes(double x, double y, int radius) :
+            _x{wasm_f64x2_splat(x)}, _y{wasm_f64x2_splat(y)}, _radius{radius}, _slack{wasm_f64x2_splat(SLACK)} {}
+
+        unsigned overlaps(const Population& p, const std::size_t* candidates) const
+        {
+            return pair(p, candidates[0], candidates[1]) | (pair(p, candidates[2], candidates[3]) << 2);
+        }
+
+    private:
+        unsigned pair(const Population& p, std::size_t a, std::size_t b) const
+        {
+            v128_t dx = wasm_f64x2_sub(wasm_f64x2_make(p.x[a], p.x[b]), _x);
+            v128_t dy = wasm_f64x2_sub(wasm_f64x2_make(p.y[a], p.y[b]), _y);
+            v128_t d2 = wasm_f64x2_add(wasm_f64x2_mul(dx, dx), wasm_f64x2_mul(dy, dy));
+
+            v128_t r = wasm_f64x2_make(_radius + p.radius[a], _radius + p.radius[b]);
+            v128_t limit = wasm_f64x2_mul(wasm_f64x2_mul(r, r), _slack);
+
+            v128_t hit = wasm_f64x2_lt(d2, limit);
+            return (wasm_i64x2_extract_lane(hit, 0) != 0 ? 1u : 0u) | (wasm_i64x2_extract_lane(hit, 1) != 0 ? 2u : 0u);
+        }
+
+        v128_t _x, _y;
+        int _radius;
+        v128_t _slack;
+};
+
+const std::size_t LANES = 4;
+const char* const NAME = "simd128";
+
+#else
+
+class Lanes
+{
+    public:
+        Lanes(double x, double y, int radius) : _x{x}, _y{y}, _radius{radius} {}
+
+        unsigned overlaps(const Population& p, const std::size_t* candidates) const
+        {
+            unsigned mask = 0;
+            for(std::size_t k = 0; k < 4; k++)
+            {
+                mask |= may_overlap(p, _x, _y, _radius, candidates[k]) ? 1u << k : 0u;
+            }
+            return mask;
+        }
+
+    private:
+        double _x, _y;
+        int _radius;
+};
+
+const std::size_t LANES = 4;
+const char* const NAME = "scalar";
+
+#endif
+
+unsigned lowest_bit(unsigned mask)
+{
+    unsigned bit = 0;
+    while(!(mask & (1u << bit)))
+    {
+        bit++;
+    }
+    return bit;
+}
+
+}
+
+const std::size_t NARROW_PHASE_LANES = LANES;
+const char* const NARROW_PHASE_NAME = NAME;
+
+std::size_t first_overlap(const Population& p, double x, double y, int radius,
+    const std::size_t* candidates, std::size_t count)
+{
+    Lanes lanes(x, y, radius);
+    std::size_t k = 0;
+    for(; k + LANES <= count; k += LANES)
+    {
+        unsigned mask = lanes.overlaps(p, candidates + k);
+        if(mask != 0)
+        {
+            return k + lowest_bit(mask);
+        }
+    }
+
+    for(; k < count; k++)
+    {
+        if(may_overlap(p, x, y, radius, candidates[k]))
+        {
+            return k;
+        }
+    }
+    return count;
+}
+
+void find_overlaps(const Population& p, double x, double y, int radius,
+    const std::size_t* candidates, std::size_t count, std::vector<std::size_t>& hits)
+{
+    Lanes lanes(x, y, radius);
+    std::size_t k = 0;
+    for(; k + LANES <= count; k += LANES)
+    {
+        for(unsigned mask = lanes.overlaps(p, candidates + k); mask != 0; mask &= mask - 1)
+        {
+            hits.push_back(k + lowest_bit(mask));
+        }
+    }
+
+    for(; k < count; k++)
+    {
+        if(may_overlap(p, x, y, radius, candidates[k]))
+        {
+            hits.push_back(k);
+        }
+    }
+}
+
+}
@@ -0,0 +1,51 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "population.h"
+
+namespace corsim
+{
+
+/**
+ * The narrow phase of the collision checks: which candidates found by the broad phase overlap a
+ * subject. Squared distances are compared with the squared sum of the radii for NARROW_PHASE_LANES
+ * candidates at once. Which version is used is decided at compile time: AVX2 on x86 builds with
+ * -mavx2, SIMD128 in WASM builds with -msimd128 and a scalar loop otherwise.
+ *
+ * The tests let through pairs that are within a rounding error of touching. The collision response
+ * makes the exact test on the few pairs that get through, so all versions give the same results.
+ */
+extern const std::size_t NARROW_PHASE_LANES;
+extern const char* const NARROW_PHASE_NAME;
+
+//
+// Returns the position in `candidates` of the first of `count` subjects of `p` that may overlap a
+// subject at (x, y) with `radius`, or `count` when none does
+//
+std::size_t first_overlap(const Population& p, double x, double y, int radius,
+    const std::size_t* candidates, std::size_t count);
+
+//
+// Appends the positions in `candidates` of all of the `count` subjects that may overlap, in ascending order
+//
+void find_overlaps(const Population& p, double x, double y, int radius,
+    const std::size_t* candidates, std::size_t count, std::vector<std::size_t>& hits);
+
+}
@@ -0,0 +1,451 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MovementStrategy/MovementStrategyInterface.h"
+#include "MovementStrategy/LockdownMovementStrategy.h"
+#include "MovementStrategy/RegularMovementStrategy.h"
+
+#include "population.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>       // std::numeric_limits
+
+namespace corsim
+{
+
+// Epochs are unique over all populations, so a population that is replaced by another never looks unchanged
+static std::uint64_t next_standstill_epoch()
+{
+    static std::atomic<std::uint64_t> epoch{0};
+    return ++epoch;
+}
+
+std::size_t Population::size() const
+{
+    return x.size();
+}
+
+void Population::clear()
+{
+    x.clear(); y.clear(); dx.clear(); dy.clear();
+    radius.clear();
+    state.clear();
+    movement.clear();
+    standstill.clear();
+    infection2immunity_start.clear(); infection2immunity_end.clear();
+    immunity_start.clear(); immunity_end.clear();
+    timer_tick.clear();
+    _timers.reset(0);
+    _live_timers = 0;
+    disease.clear();
+    diseases.clear();
+    custom_strategies.clear();
+    _compartments = Compartments();
+    _infected.clear();
+    _infected_slot.clear();
+    _standstill_epoch = next_standstill_epoch();
+}
+
+void Population::reserve(std::size_t count)
+{
+    x.reserve(count); y.reserve(count); dx.reserve(count); dy.reserve(count);
+    radius.reserve(count);
+    state.reserve(count);
+    movement.reserve(count);
+    standstill.reserve(count);
+    infection2immunity_start.reserve(count); infection2immunity_end.reserve(count);
+    immunity_start.reserve(count); immunity_end.reserve(count);
+    timer_tick.reserve(count);
+    disease.reserve(count);
+    _infected_slot.reserve(count);
+}
+
+void Population::resize(std::size_t count)
+{
+    x.resize(count); y.resize(count); dx.resize(count); dy.resize(count);
+    radius.resize(count);
+    state.resize(count);
+    movement.resize(count);
+    standstill.resize(count);
+    infection2immunity_start.resize(count); infection2immunity_end.resize(count);
+    immunity_start.resize(count); immunity_end.resize(count);
+    timer_tick.resize(count);
+    disease.resize(count);
+    _infected.clear();
+    _infected_slot.assign(count, NOT_LISTED);
+    custom_strategies.clear();
+}
+
+void Population::columns_changed(int counter)
+{
+    _compartments = Compartments();
+    _infected.clear();
+    _infected_slot.assign(size(), NOT_LISTED);
+    for(std::size_t i = 0; i < size(); i++)
+    {
+        standstill[i] = movement[i] == MOVEMENT_LOCKDOWN;
+        add_to_compartments(state[i], standstill[i], 1);
+        set_infected_listed(i, state[i] & STATE_INFECTED);
+    }
+    _standstill_epoch = next_standstill_epoch();
+
+    _timers.reset(counter);
+    timer_tick.assign(size(), -1);
+    _live_timers = 0;
+    for(std::size_t i = 0; i < size(); i++)
+    {
+        schedule_timer(i);
+    }
+}
+
+std::size_t Population::add(double x, double y, int radius, bool infected, std::uint16_t disease)
+{
+    this->x.push_back(x);
+    this->y.push_back(y);
+    this->dx.push_back(0);
+    this->dy.push_back(0);
+    this->radius.push_back(radius);
+    this->state.push_back(infected ? STATE_INFECTED : 0);
+    this->movement.push_back(MOVEMENT_REGULAR);
+    this->standstill.push_back(false);
+    this->infection2immunity_start.push_back(std::numeric_limits<int>::max());
+    this->infection2immunity_end.push_back(std::numeric_limits<int>::max());
+    this->immunity_start.push_back(std::numeric_limits<int>::max());
+    this->immunity_end.push_back(std::numeric_limits<int>::max());
+    this->timer_tick.push_back(-1);
+    this->disease.push_back(disease);
+    _infected_slot.push_back(NOT_LISTED);
+    add_to_compartments(this->state.back(), false, 1);
+    set_infected_listed(size() - 1, infected);
+    _standstill_epoch = next_standstill_epoch();
+    return size() - 1;
+}
+
+std::size_t Population::append(const Population& other, std::size_t index)
+{
+    std::size_t i = add(0, 0, 0, false, add_disease(other.disease_of(index)));
+    assign(i, other, index);
+    return i;
+}
+
+void Population::assign(std::size_t index, const Population& other, std::size_t from_index)
+{
+    x[index] = other.x[from_index];
+    y[index] = other.y[from_index];
+    dx[index] = other.dx[from_index];
+    dy[index] = other.dy[from_index];
+    radius[index] = other.radius[from_index];
+    set_state(index, other.state[from_index]);
+    movement[index] = other.movement[from_index];
+    set_standstill(index, other.standstill[from_index]);
+    infection2immunity_start[index] = other.infection2immunity_start[from_index];
+    infection2immunity_end[index] = other.infection2immunity_end[from_index];
+    immunity_start[index] = other.immunity_start[from_index];
+    immunity_end[index] = other.immunity_end[from_index];
+    disease[index] = &other == this ? other.disease[from_index] : add_disease(other.disease_of(from_index));
+    schedule_timer(index);
+    auto custom = other.custom_strategies.find(from_index);
+    if(custom != other.custom_strategies.end())
+    {
+        custom_strategies[index] = custom->second;
+    }
+    else
+    {
+        custom_strategies.erase(index);
+    }
+    _standstill_epoch = next_standstill_epoch();
+}
+
+std::uint16_t Population::add_disease(const DiseaseParameters& parameters)
+{
+    // There are only a few variants, a linear search is fine
+    for(std::size_t d = 0; d < diseases.size(); d++)
+    {
+        if(diseases[d] == parameters)
+        {
+            return (std::uint16_t)d;
+        }
+    }
+    diseases.push_back(parameters);
+    return (std::uint16_t)(diseases.size() - 1);
+}
+
+//
+// A. bind a concrete strategy algorithm to subject i. Whether it stands still is cached so the
+// simulation loops do not have to go through the strategy for every position update.
+//
+void Population::set_movement(std::size_t i, MovementKind kind)
+{
+    movement[i] = kind;
+    set_standstill(i, kind == MOVEMENT_LOCKDOWN);
+    custom_strategies.erase(i);
+    _standstill_epoch = next_standstill_epoch();
+}
+
+void Population::set_movement_strategy(std::size_t i, std::shared_ptr<MovementStrategyInterface> strategy)
+{
+    // The built in strategies keep no state, they do not have to be kept around
+    if(strategy == nullptr || dynamic_cast<RegularMovement*>(strategy.get()) != nullptr)
+    {
+        set_movement(i, MOVEMENT_REGULAR);
+    }
+    else if(dynamic_cast<LockdownMovement*>(strategy.get()) != nullptr)
+    {
+        set_movement(i, MOVEMENT_LOCKDOWN);
+    }
+    else
+    {
+        movement[i] = MOVEMENT_CUSTOM;
+        set_standstill(i, strategy->IsStandStill());
+        custom_strategies[i] = std::move(strategy);
+        _standstill_epoch = next_standstill_epoch();
+    }
+}
+
+void Population::set_movement_strategy(std::size_t i, std::shared_ptr<MovementStrategyInterface*> strategy)
+{
+    // The shared pointer to the raw pointer keeps the strategy alive, it is not deleted
+    MovementStrategyInterface* raw = strategy != nullptr ? *strategy : nullptr;
+    set_movement_strategy(i, std::shared_ptr<MovementStrategyInterface>(std::move(strategy), raw));
+}
+
+MovementStrategyInterface* Population::custom_strategy(std::size_t i) const
+{
+    auto custom = custom_strategies.find(i);
+    return custom != custom_strategies.end() ? custom->second.get() : nullptr;
+}
+
+void Population::infect(std::size_t i)
+{
+    //
+    // B.3. if immuned cant be infected
+    //
+    if(!immune(i))
+    {
+        set_state(i, state[i] | STATE_INFECTED);
+    }
+}
+
+   // -----------------------------------------------------------------------------------------------------------------------------------
+   // B.3. do_tick
+   // -----------------------------------------------------------------------------------------------------------------------------------
+   // Track and change (transition) immunity state of subject i at tick counter.
+   // -----------------------------------------------------------------------------------------------------------------------------------
+void Population::do_tick(std::size_t i, int counter)
+{
+    int current_time = counter * disease_of(i).tick_speed;
+
+    if(infected(i) && !immune(i)) // subject is infected test when it will get immuned
+    {
+        // did infection to immunity period expiered?
+        if(current_time >= infection2immunity_end[i])
+        {
+            start_immunity(i);
+            set_state(i, state[i] & ~STATE_INFECTED); // immuned are not infected
+            if(event_log != nullptr)
+            {
+                event_log->push_back({counter, EVENT_IMMUNITY_START, (std::uint32_t)i, 0});
+            }
+        }
+    }
+    else if(immune(i)) // immunity is on
+    {
+        // did wait for immunity period expiered?
+        if(current_time >= immunity_end[i])
+        {
+            end_immunity(i);
+            if(event_log != nullptr)
+            {
+                event_log->push_back({counter, EVENT_IMMUNITY_END, (std::uint32_t)i, 0});
+            }
+        }
+    }
+}
+
+void Population::start_immunity(std::size_t i)
+{
+    set_state(i, state[i] | STATE_IMMUNE);
+    schedule_timer(i);
+}
+
+   // -----------------------------------------------------------------------------------------------------------------------------------
+   // B.3. start_infection2immunity_period
+   // -----------------------------------------------------------------------------------------------------------------------------------
+   // Only NOT-immuned subjects can get infected, so only they start the infection to immunity period.
+   // The counter is converted to milliseconds, the period after it in which the subject is immune
+   // is scheduled right away.
+   // -----------------------------------------------------------------------------------------------------------------------------------
+void Population::start_infection2immunity_period(std::size_t i, int counter)
+{
+    if(!immune(i))
+    {
+        const DiseaseParameters& parameters = disease_of(i);
+        infection2immunity_start[i] = counter * parameters.tick_speed;
+        infection2immunity_end[i] = infection2immunity_start[i] + parameters.infection2immunity_duration;
+
+        immunity_start[i] = infection2immunity_end[i];
+        immunity_end[i] = immunity_start[i] + parameters.immunity_duration;
+        schedule_timer(i);
+    }
+}
+
+void Population::end_immunity(std::size_t i)
+{
+    // before immunity
+    infection2immunity_start[i] = std::numeric_limits<int>::max();
+    infection2immunity_end[i] = std::numeric_limits<int>::max();
+
+    // when immuned
+    immunity_start[i] = std::numeric_limits<int>::max();
+    immunity_end[i] = std::numeric_limits<int>::max();
+
+    // reset immunity (after expiration period)
+    set_state(i, state[i] & ~STATE_IMMUNE);
+    schedule_timer(i);
+}
+
+   // -----------------------------------------------------------------------------------------------------------------------------------
+   // B.3. schedule_timer
+   // -----------------------------------------------------------------------------------------------------------------------------------
+   // do_tick only changes the state of an infected subject once its infection to immunity period is over, and of an
+   // immune subject once its immunity is over. Converted to ticks that is the first counter for which
+   // counter * tick_speed reaches the end of the period, or the next tick when that has already passed.
+   //
+   // Infections restart the period, which only moves the end further away. A timer that fires too early is
+   // simply set again, so there is only one timer per subject in the wheel while its period keeps restarting.
+   // -----------------------------------------------------------------------------------------------------------------------------------
+void Population::schedule_timer(std::size_t i)
+{
+    int end = std::numeric_limits<int>::max();
+    if(infected(i) && !immune(i))
+    {
+        end = infection2immunity_end[i];
+    }
+    else if(immune(i))
+    {
+        end = immunity_end[i];
+    }
+
+    int speed = disease_of(i).tick_speed;
+    if(end == std::numeric_limits<int>::max() || (speed <= 0 && end > 0))
+    {
+        if(timer_tick[i] != -1)
+        {
+            _live_timers--;
+        }
+        timer_tick[i] = -1;
+        return;
+    }
+
+    int tick = speed > 0 ? (end <= 0 ? 0 : (end - 1) / speed + 1) : 0;
+    tick = std::max(tick, _timers.now() + 1);
+
+    if(timer_tick[i] != -1 && timer_tick[i] <= tick)
+    {
+        return;
+    }
+    if(timer_tick[i] == -1)
+    {
+        _live_timers++;
+    }
+    timer_tick[i] = tick;
+    _timers.schedule(i, tick);
+}
+
+void Population::set_state(std::size_t i, std::uint8_t value)
+{
+    add_to_compartments(state[i], standstill[i], -1);
+    state[i] = value;
+    add_to_compartments(state[i], standstill[i], 1);
+    set_infected_listed(i, value & STATE_INFECTED);
+}
+
+void Population::set_infected_listed(std::size_t i, bool listed)
+{
+    if(listed == (_infected_slot[i] != NOT_LISTED))
+    {
+        return;
+    }
+
+    if(listed)
+    {
+        _infected_slot[i] = _infected.size();
+        _infected.push_back(i);
+    }
+    else
+    {
+        // The last one takes the place of i
+        std::size_t last = _infected.back();
+        _infected[_infected_slot[i]] = last;
+        _infected_slot[last] = _infected_slot[i];
+        _infected.pop_back();
+        _infected_slot[i] = NOT_LISTED;
+    }
+}
+
+void Population::set_standstill(std::size_t i, bool value)
+{
+    add_to_compartments(state[i], standstill[i], -1);
+    standstill[i] = value;
+    add_to_compartments(state[i], standstill[i], 1);
+}
+
+//
+// Adds delta to the compartments of a subject in `subject_state` that does or does not stand still
+//
+void Population::add_to_compartments(std::uint8_t subject_state, bool stands_still, int delta)
+{
+    if(subject_state & STATE_INFECTED)
+    {
+        _compartments.infected += delta;
+    }
+    if(subject_state & STATE_IMMUNE)
+    {
+        _compartments.immune += delta;
+    }
+    if(!(subject_state & (STATE_INFECTED | STATE_IMMUNE)))
+    {
+        _compartments.susceptible += delta;
+    }
+    (stands_still ? _compartments.locked_down : _compartments.moving) += delta;
+}
+
+void Population::tick_timers(int counter)
+{
+    // Timers are kept per tick, catch up when ticks were skipped
+    while(_timers.now() < counter)
+    {
+        _due.clear();
+        _timers.advance(_due);
+
+        int now = _timers.now();
+        for(std::size_t i : _due)
+        {
+            // Timers that were replaced by an earlier one are left in the wheel, skip them
+            if(timer_tick[i] != now)
+            {
+                continue;
+            }
+
+            timer_tick[i] = -1;
+            _live_timers--;
+            do_tick(i, now);
+            schedule_timer(i);
+        }
+    }
+}
+
+}
@@ -0,0 +1,227 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "compartments.h"
+#include "timer_wheel.h"
+
+class MovementStrategyInterface;
+
+namespace corsim
+{
+
+enum SubjectStateFlags : std::uint8_t
+{
+    STATE_INFECTED = 1,
+    STATE_IMMUNE = 2
+};
+
+//
+// B.3. a change of the disease state of a subject, see Population::event_log
+//
+enum SubjectEventType : std::uint8_t
+{
+    EVENT_INFECTION = 0,      // source infected subject
+    EVENT_IMMUNITY_START = 1,
+    EVENT_IMMUNITY_END = 2
+};
+
+struct SubjectEvent
+{
+    std::int32_t tick;
+    std::uint8_t type;       // SubjectEventType
+    std::uint32_t subject;
+    std::uint32_t source;    // only for EVENT_INFECTION
+};
+
+/**
+ * B.3. the course of a disease, in milliseconds of simulated time. Subjects refer to an entry of the
+ * table of their population, so several variants of a pathogen can be simulated side by side.
+ */
+struct DiseaseParameters
+{
+    int infection2immunity_duration = 0; // from the moment a subject is infected until it is immune
+    int immunity_duration = 0;           // from the moment a subject is immune until it can be infected again
+    int tick_speed = 1000/30;            // milliseconds per tick, must match the simulation
+
+    bool operator==(const DiseaseParameters& other) const
+    {
+        return infection2immunity_duration == other.infection2immunity_duration &&
+            immunity_duration == other.immunity_duration && tick_speed == other.tick_speed;
+    }
+};
+
+//
+// A. the movement strategy of a subject. The built in strategies are only a tag, any other
+// MovementStrategyInterface is kept in Population::custom_strategies.
+//
+enum MovementKind : std::uint8_t
+{
+    MOVEMENT_REGULAR = 0,  // RegularMovement, moves with its speed
+    MOVEMENT_LOCKDOWN = 1, // LockdownMovement, stands still
+    MOVEMENT_CUSTOM = 2
+};
+
+/**
+ * The population holds the data of all subjects as a structure of arrays: every
+ * field of a subject is stored in its own contiguous column, indexed by subject.
+ * The simulation loops only touch the columns they need, so positions and
+ * velocities of neighbouring subjects share cache lines.
+ *
+ * The disease state transitions (B.3.) live here as well, Subject forwards to them. Every
+ * subject with a pending transition has a timer for the tick it happens on, so a tick only
+ * has to look at the subjects whose timer fires.
+ *
+ * The state and standstill columns are only changed through the methods of the population, which keep
+ * the compartment counters up to date, so they can be read at any time without counting.
+ */
+class Population
+{
+    public:
+        std::size_t size() const;
+        void clear();
+        void reserve(std::size_t count);
+
+        //
+        // Resizes every column to `count` subjects and drops all custom strategies, for filling in the
+        // columns directly. Call columns_changed afterwards.
+        //
+        void resize(std::size_t count);
+
+        //
+        // Tells the population its columns were written directly: the standstill column is derived from the
+        // movement column again and the timers are set up again, with `counter` as the tick that was last run
+        //
+        void columns_changed(int counter);
+
+        //
+        // Adds a subject with entry `disease` of the disease parameter table and returns its index
+        //
+        std::size_t add(double x, double y, int radius, bool infected, std::uint16_t disease);
+
+        //
+        // Returns the index of `parameters` in the disease parameter table, adding them when they are not in it yet
+        //
+        std::uint16_t add_disease(const DiseaseParameters& parameters);
+        const DiseaseParameters& disease_of(std::size_t i) const { return diseases[disease[i]]; }
+
+        //
+        // Adds a copy of subject `index` of `other` and returns its new index
+        //
+        std::size_t append(const Population& other, std::size_t index);
+
+        //
+        // Copies subject `from_index` of `other` over subject `index`
+        //
+        void assign(std::size_t index, const Population& other, std::size_t from_index);
+
+        bool infected(std::size_t i) const { return state[i] & STATE_INFECTED; }
+        bool immune(std::size_t i) const { return state[i] & STATE_IMMUNE; }
+        bool stand_still(std::size_t i) const { return standstill[i]; }
+
+        //
+        // A. position setters ignore the new position when the movement strategy of the subject stands still
+        //
+        void set_x(std::size_t i, double value) { if(!standstill[i]) x[i] = value; }
+        void set_y(std::size_t i, double value) { if(!standstill[i]) y[i] = value; }
+
+        //
+        // A. binds a movement strategy to subject i. The built in strategies are stored as their MovementKind, a
+        // custom strategy is kept with the subject and its Move is called once every tick before the subject is
+        // moved. A custom strategy that stands still must not change the position.
+        //
+        void set_movement(std::size_t i, MovementKind kind);
+        void set_movement_strategy(std::size_t i, std::shared_ptr<MovementStrategyInterface> strategy);
+        void set_movement_strategy(std::size_t i, std::shared_ptr<MovementStrategyInterface*> strategy);
+        MovementStrategyInterface* custom_strategy(std::size_t i) const; // nullptr unless MOVEMENT_CUSTOM
+
+        //
+        // Changes whenever a subject is added or replaced, or its movement strategy changes, so users can tell
+        // when what they derived from the standstill column is out of date
+        //
+        std::uint64_t standstill_epoch() const { return _standstill_epoch; }
+
+        const Compartments& compartments() const { return _compartments; }
+
+        //
+        // The infected subjects, in no particular order. Kept up to date like the compartments, so passes that only
+        // concern infected subjects do not have to look at the others.
+        //
+        const std::vector<std::size_t>& infected_subjects() const { return _infected; }
+
+        // B.3. immunity state transitions, counter is the tick count of the simulation
+        void infect(std::size_t i);
+        void do_tick(std::size_t i, int counter);
+        //
+        // Runs do_tick for the subjects with a transition due on tick `counter`, the tick after the previous
+        // call. Gives the same result as running do_tick for every subject.
+        //
+        void tick_timers(int counter);
+        //
+        // Number of subjects with a transition to come. Timers replaced by an earlier one stay in the wheel until
+        // they would have fired, they are not counted.
+        //
+        std::size_t pending_timers() const { return _live_timers; }
+
+        // When set, do_tick appends the immunity transitions it makes. Infections are logged by the simulation,
+        // which knows who infected whom.
+        std::vector<SubjectEvent>* event_log = nullptr;
+        void start_immunity(std::size_t i);
+        void start_infection2immunity_period(std::size_t i, int counter);
+        void end_immunity(std::size_t i);
+
+        // Hot columns, iterated every tick
+        std::vector<double> x, y, dx, dy;
+        std::vector<int> radius;
+        std::vector<std::uint8_t> state;      // SubjectStateFlags
+        std::vector<std::uint8_t> movement;   // MovementKind
+        std::vector<std::uint8_t> standstill; // cached IsStandStill() of the movement strategy
+
+        // B.3. timestamps in milliseconds, std::numeric_limits<int>::max() when not running
+        std::vector<int> infection2immunity_start, infection2immunity_end;
+        std::vector<int> immunity_start, immunity_end;
+        std::vector<int> timer_tick; // tick the timer of the subject fires on, -1 when there is none
+
+        // Cold columns
+        std::vector<std::uint16_t> disease; // index into diseases
+        std::vector<DiseaseParameters> diseases;
+        std::unordered_map<std::size_t, std::shared_ptr<MovementStrategyInterface>> custom_strategies; // by subject
+
+    private:
+        static constexpr std::size_t NOT_LISTED = ~(std::size_t)0;
+
+        void schedule_timer(std::size_t i);
+        void set_state(std::size_t i, std::uint8_t value);
+        void set_standstill(std::size_t i, bool value);
+        void add_to_compartments(std::uint8_t subject_state, bool stands_still, int delta);
+        void set_infected_listed(std::size_t i, bool listed);
+
+        std::uint64_t _standstill_epoch = 0;
+        Compartments _compartments;
+        std::vector<std::size_t> _infected;
+        std::vector<std::size_t> _infected_slot; // position of every subject in _infected, NOT_LISTED when not infected
+        TimerWheel _timers;
+        std::size_t _live_timers = 0; // subjects with timer_tick set
+        std::vector<std::size_t> _due;
+};
+
+}
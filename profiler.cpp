@@ -0,0 +1,157 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+namespace corsim
+{
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() : _epoch{std::chrono::steady_clock::now()} {}
+
+int Profiler::thread_number()
+{
+    std::size_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    auto it = std::find(_threads.begin(), _threads.end(), id);
+    if(it != _threads.end())
+    {
+        return it - _threads.begin();
+    }
+    _threads.push_back(id);
+    return _threads.size() - 1;
+}
+
+void Profiler::record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    long long start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - _epoch).count();
+    long long duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(_events.size() < MAX_EVENTS)
+    {
+        _events.push_back({name, start_ns, duration_ns, thread_number()});
+    }
+    _current_sample[name] += duration_ns;
+}
+
+void Profiler::end_sample()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(auto& phase : _current_sample)
+    {
+        _samples[phase.first].push_back(phase.second / 1000.0);
+    }
+    _current_sample.clear();
+}
+
+void Profiler::reset()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _events.clear();
+    _current_sample.clear();
+    _samples.clear();
+}
+
+void Profiler::write_summary(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Sorted by name, so nested phases ("tick.collisions") end up below their parent ("tick")
+    std::map<std::string, std::vector<double>*> phases;
+    for(auto& phase : _samples)
+    {
+        phases[phase.first] = &phase.second;
+    }
+
+    out << std::left << std::setw(24) << "phase" << std::right << std::setw(10) << "samples"
+        << std::setw(12) << "min us" << std::setw(12) << "mean us" << std::setw(12) << "p99 us" << '\n';
+
+    for(auto& phase : phases)
+    {
+        std::vector<double> sorted = *phase.second;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for(double sample : sorted)
+        {
+            total += sample;
+        }
+        std::size_t p99 = std::min(sorted.size() - 1, (std::size_t)(sorted.size() * 0.99));
+
+        out << std::left << std::setw(24) << phase.first << std::right << std::setw(10) << sorted.size()
+            << std::fixed << std::setprecision(2)
+            << std::setw(12) << sorted.front() << std::setw(12) << total / sorted.size() << std::setw(12) << sorted[p99] << '\n';
+    }
+}
+
+void Profiler::write_trace(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Chrome expects timestamps in microseconds
+    out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    for(std::size_t i = 0; i < _events.size(); i++)
+    {
+        const Event& e = _events[i];
+        out << (i == 0 ? "" : ",") << "\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+            << ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << e.duration / 1000.0 << '}';
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool Profiler::write_trace(const std::string& path)
+{
+    std::ofstream file(path);
+    write_trace(file);
+    return (bool)file;
+}
+
+}
+
+#ifdef __EMSCRIPTEN__
+//
+// Call Module._corsim_write_profile() from the browser console to print the summary and download the trace
+//
+extern "C" EMSCRIPTEN_KEEPALIVE void corsim_write_profile()
+{
+    std::ostringstream summary, trace;
+    corsim::Profiler::instance().write_summary(summary);
+    corsim::Profiler::instance().write_trace(trace);
+
+    // The page has the document, the worker of a CORSIM_WORKER build does not. Waits for the page, so the strings
+    // stay alive until it is done with them.
+    MAIN_THREAD_EM_ASM({
+        console.log(Module.AsciiToString($0));
+        var blob = new Blob([Module.AsciiToString($1)], {type: 'application/json'});
+        var link = document.createElement('a');
+        link.href = URL.createObjectURL(blob);
+        link.download = 'corsim_trace.json';
+        link.click();
+    }, summary.str().c_str(), trace.str().c_str());
+}
+#endif
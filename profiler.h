@@ -0,0 +1,104 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//
+// CORSIM_PROFILE_SCOPE("name") times the rest of the enclosing scope. Profiling is only compiled in
+// when CORSIM_PROFILE is defined, otherwise the macros expand to nothing.
+// CORSIM_PROFILE_SAMPLE() closes a sample (a tick or a frame) for the per phase aggregates.
+//
+#ifdef CORSIM_PROFILE
+#define CORSIM_PROFILE_CONCAT_(a, b) a##b
+#define CORSIM_PROFILE_CONCAT(a, b) CORSIM_PROFILE_CONCAT_(a, b)
+#define CORSIM_PROFILE_SCOPE(name) corsim::ProfileScope CORSIM_PROFILE_CONCAT(corsim_profile_scope_, __LINE__)(name)
+#define CORSIM_PROFILE_SAMPLE() corsim::Profiler::instance().end_sample()
+#else
+#define CORSIM_PROFILE_SCOPE(name) ((void)0)
+#define CORSIM_PROFILE_SAMPLE() ((void)0)
+#endif
+
+namespace corsim
+{
+
+/**
+ * Collects the timings of profiled scopes. Every scope is kept as a trace event that can be
+ * written as a Chrome trace_event JSON file (about:tracing, Perfetto), and the time spent in
+ * every phase per sample is kept to report min, mean and p99 per phase.
+ *
+ * Scope names must be string literals, they are stored as pointers.
+ */
+class Profiler
+{
+    public:
+        static Profiler& instance();
+
+        void record(const char* name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+        void end_sample();
+        void reset();
+
+        void write_summary(std::ostream& out);
+        void write_trace(std::ostream& out);
+        bool write_trace(const std::string& path);
+
+    private:
+        Profiler();
+
+        struct Event
+        {
+            const char* name;
+            long long start, duration; // nanoseconds since the profiler was created
+            int thread;
+        };
+
+        // No more events are kept after this many, the aggregates keep counting
+        static const std::size_t MAX_EVENTS = 1 << 22;
+
+        int thread_number();
+
+        std::mutex _mutex;
+        std::chrono::steady_clock::time_point _epoch;
+        std::vector<Event> _events;
+        std::map<const char*, long long> _current_sample;  // time per phase in the open sample
+        std::map<const char*, std::vector<double>> _samples; // microseconds per phase per sample
+        std::vector<std::size_t> _threads;                  // hashed thread ids, index is the thread number
+};
+
+/**
+ * Records the time between its construction and destruction with the Profiler
+ */
+class ProfileScope
+{
+    public:
+        // The profiler is fetched first, so its epoch is never later than the start of the first scope
+        explicit ProfileScope(const char* name) : _profiler{Profiler::instance()}, _name{name}, _start{std::chrono::steady_clock::now()} {}
+        ~ProfileScope() { _profiler.record(_name, _start, std::chrono::steady_clock::now()); }
+
+    private:
+        Profiler& _profiler;
+        const char* _name;
+        std::chrono::steady_clock::time_point _start;
+};
+
+}
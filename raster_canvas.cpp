@@ -0,0 +1,171 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "raster_canvas.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <math.h>
+
+namespace corsim
+{
+
+// Stores the bytes R, G, B, A in memory order whatever the endianness
+std::uint32_t rgba(std::uint8_t r, std::uint8_t g, std::uint8_t b, std::uint8_t a)
+{
+    std::uint8_t bytes[4] = {r, g, b, a};
+    std::uint32_t pixel;
+    std::memcpy(&pixel, bytes, 4);
+    return pixel;
+}
+
+RasterCanvas::RasterCanvas(int width, int height) :
+    _width{width}, _height{height}, _pixels(width * height)
+{
+    // Same colours as the CSS colour names HTMLCanvas uses
+    _palette[RED] = rgba(255, 0, 0, 255);
+    _palette[GREEN] = rgba(0, 128, 0, 255);
+    _palette[BLUE] = rgba(0, 0, 255, 255);
+    _palette[ORANGE] = rgba(255, 165, 0, 255);
+    _palette[BLACK] = rgba(0, 0, 0, 255);
+    _palette[SHADE_BLUE] = rgba(173, 216, 230, 255);
+    _palette[SHADE_ORANGE] = rgba(255, 218, 185, 255);
+    _palette[MAGENTA] = rgba(255, 0, 255, 255);
+    _palette[YELLOW] = rgba(255, 255, 0, 255);
+
+    clear();
+}
+
+void RasterCanvas::clear()
+{
+    std::fill(_pixels.begin(), _pixels.end(), rgba(255, 255, 255, 255));
+}
+
+void RasterCanvas::fill_span(int y, int x0, int x1, std::uint32_t color)
+{
+    if(y < 0 || y >= _height)
+    {
+        return;
+    }
+
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, _width - 1);
+
+    std::uint32_t* row = _pixels.data() + (std::size_t)y * _width;
+    for(int x = x0; x <= x1; x++)
+    {
+        row[x] = color;
+    }
+}
+
+void RasterCanvas::draw_pixel(double x, double y, CanvasColor color)
+{
+    int px = (int)floor(x);
+    fill_span((int)floor(y), px, px, _palette[color]);
+}
+
+void RasterCanvas::draw_rectangle(double x, double y, double width, double height, CanvasColor color)
+{
+    // Pixels whose centre lies inside [x, x + width) x [y, y + height)
+    int x0 = (int)ceil(x - 0.5);
+    int x1 = (int)ceil(x + width - 0.5) - 1;
+    int y0 = std::max((int)ceil(y - 0.5), 0);
+    int y1 = std::min((int)ceil(y + height - 0.5) - 1, _height - 1);
+
+    for(int py = y0; py <= y1; py++)
+    {
+        fill_span(py, x0, x1, _palette[color]);
+    }
+}
+
+//
+// Filled circle, one span per row. Subjects are only a few pixels across, so this is a
+// handful of square roots and short stores per circle.
+//
+void RasterCanvas::draw_ellipse(double x, double y, double radius, CanvasColor color)
+{
+    std::uint32_t c = _palette[color];
+    double r2 = radius * radius;
+    int y0 = std::max((int)ceil(y - radius - 0.5), 0);
+    int y1 = std::min((int)floor(y + radius - 0.5), _height - 1);
+
+    for(int py = y0; py <= y1; py++)
+    {
+        double dy = py + 0.5 - y;
+        double half = sqrt(std::max(r2 - dy * dy, 0.0));
+        fill_span(py, (int)ceil(x - half - 0.5), (int)floor(x + half - 0.5), c);
+    }
+}
+
+void RasterCanvas::present()
+{
+    if(!_frame_directory.empty())
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%05d.ppm", _frame++);
+        write_ppm(_frame_directory + name);
+    }
+}
+
+void RasterCanvas::set_frame_output(const std::string& directory)
+{
+    _frame_directory = directory;
+    _frame = 0;
+}
+
+bool RasterCanvas::write_ppm(const std::string& path) const
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if(file == nullptr)
+    {
+        return false;
+    }
+
+    std::fprintf(file, "P6\n%d %d\n255\n", _width, _height);
+
+    // PPM has no alpha channel, write row by row without it
+    std::vector<std::uint8_t> row(_width * 3);
+    const std::uint8_t* source = pixels();
+    for(int y = 0; y < _height; y++)
+    {
+        for(int x = 0; x < _width; x++, source += 4)
+        {
+            row[x * 3] = source[0];
+            row[x * 3 + 1] = source[1];
+            row[x * 3 + 2] = source[2];
+        }
+        std::fwrite(row.data(), 1, row.size(), file);
+    }
+
+    return std::fclose(file) == 0;
+}
+
+const std::uint8_t* RasterCanvas::pixels() const
+{
+    return reinterpret_cast<const std::uint8_t*>(_pixels.data());
+}
+
+int RasterCanvas::width() const
+{
+    return _width;
+}
+
+int RasterCanvas::height() const
+{
+    return _height;
+}
+
+}
@@ -0,0 +1,64 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "canvas.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace corsim
+{
+
+/**
+ * A canvas that rasterises everything in C++ into an RGBA framebuffer that is allocated
+ * once. Drawing never allocates. A pixel is covered by a shape when its centre is.
+ *
+ * On its own it can write frames to disk as PPM images, the browser build blits the
+ * buffer to the page with HTMLRasterCanvas.
+ */
+class RasterCanvas : public Canvas
+{
+    public:
+    RasterCanvas(int width, int height);
+    void clear() override;
+    void draw_pixel(double x, double y, CanvasColor color) override;
+    void draw_rectangle(double x, double y, double width, double height, CanvasColor color) override;
+    void draw_ellipse(double x, double y, double radius, CanvasColor color) override;
+    void present() override;
+
+    //
+    // When set, every presented frame is written to directory/frame_NNNNN.ppm
+    //
+    void set_frame_output(const std::string& directory);
+    bool write_ppm(const std::string& path) const;
+
+    const std::uint8_t* pixels() const; // width * height RGBA pixels, row by row
+    int width() const;
+    int height() const;
+
+    protected:
+    void fill_span(int y, int x0, int x1, std::uint32_t color);
+
+    int _width, _height;
+    std::vector<std::uint32_t> _pixels;
+    std::uint32_t _palette[CANVAS_COLOR_COUNT];
+    std::string _frame_directory;
+    int _frame = 0;
+};
+
+}
@@ -0,0 +1,202 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "record_reader.h"
+#include <algorithm>
+#include <cstring>
+
+namespace corsim
+{
+
+namespace
+{
+
+const std::uint32_t RECORDING_VERSION = 1;
+
+template<typename T>
+bool get_raw(std::ifstream& file, T& value)
+{
+    return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+}
+
+RecordReader::RecordReader(const std::string& path) : _file(path, std::ios::binary)
+{
+    char magic[8];
+    std::uint32_t version = 0, scale = 0;
+    _good = _file.read(magic, sizeof(magic)) && std::memcmp(magic, "CORSIMRC", sizeof(magic)) == 0 &&
+        get_raw(_file, version) && version == RECORDING_VERSION && get_raw(_file, scale) && scale > 0;
+    _position_scale = (int)scale;
+
+    // Sizes in the chunk headers are checked against what is left of the file before anything is allocated
+    std::streampos start = _file.tellg();
+    _good = _good && _file.seekg(0, std::ios::end);
+    _file_size = _good ? (std::uint64_t)_file.tellg() : 0;
+    _good = _good && _file.seekg(start);
+}
+
+bool RecordReader::next(RecordedFrame& frame)
+{
+    if(!_good)
+    {
+        return false;
+    }
+    if(_chunk_tick == _chunk_ticks && !read_chunk())
+    {
+        return false;
+    }
+
+    std::size_t n = _chunk_subjects;
+    std::uint64_t tick = 0;
+    _good = get_varint(TICKS, tick);
+    frame.tick = (int)tick;
+    frame.x.resize(n);
+    frame.y.resize(n);
+
+    for(std::size_t i = 0; i < n && _good; i++)
+    {
+        std::int64_t delta = 0;
+        _good = get_zigzag(XS, delta);
+        frame.x[i] = _last_x[i] += (std::int32_t)delta;
+    }
+    for(std::size_t i = 0; i < n && _good; i++)
+    {
+        std::int64_t delta = 0;
+        _good = get_zigzag(YS, delta);
+        frame.y[i] = _last_y[i] += (std::int32_t)delta;
+    }
+
+    // Runs of unchanged subjects, each followed by the change of the next subject unless it runs to the end
+    std::size_t i = 0;
+    while(i < n && _good)
+    {
+        std::uint64_t zeros = 0;
+        _good = get_varint(STATES, zeros) && zeros <= n - i;
+        i += _good ? zeros : 0;
+        if(_good && i < n)
+        {
+            _good = _read[STATES] < _columns[STATES].size();
+            if(_good)
+            {
+                _last_state[i++] ^= _columns[STATES][_read[STATES]++];
+            }
+        }
+    }
+    frame.state = _last_state;
+
+    // Events are stored for the whole chunk, those up to this tick happened since the previous one
+    frame.events.clear();
+    while(_next_event < _events.size() && _events[_next_event].tick <= frame.tick)
+    {
+        frame.events.push_back(_events[_next_event++]);
+    }
+
+    _chunk_tick++;
+    return _good;
+}
+
+bool RecordReader::read_chunk()
+{
+    char magic[4];
+    if(!_file.read(magic, sizeof(magic)))
+    {
+        return false; // end of the recording
+    }
+
+    std::uint32_t ticks = 0, event_count = 0;
+    std::uint64_t subjects = 0, sizes[COLUMN_COUNT];
+    _good = std::memcmp(magic, "CHNK", sizeof(magic)) == 0 && get_raw(_file, ticks) && get_raw(_file, subjects) &&
+        get_raw(_file, event_count);
+    for(std::uint64_t& size : sizes)
+    {
+        _good = _good && get_raw(_file, size);
+    }
+
+    // A damaged header must not make the reader allocate what is not there: the columns have to fit in the rest of
+    // the file, and every subject takes at least a byte of every position column per tick, every event four bytes
+    std::uint64_t left = _good ? _file_size - (std::uint64_t)_file.tellg() : 0;
+    for(int c = 0; c < COLUMN_COUNT && _good; c++)
+    {
+        _good = sizes[c] <= left;
+        left -= _good ? sizes[c] : 0;
+    }
+    _good = _good && ticks > 0 && subjects <= std::min(sizes[XS], sizes[YS]) / ticks && event_count <= sizes[EVENTS] / 4;
+
+    for(int c = 0; c < COLUMN_COUNT && _good; c++)
+    {
+        _columns[c].resize(sizes[c]);
+        _good = (bool)_file.read(reinterpret_cast<char*>(_columns[c].data()), sizes[c]);
+        _read[c] = 0;
+    }
+    if(!_good)
+    {
+        return false;
+    }
+
+    _events.clear();
+    _next_event = 0;
+    for(std::uint32_t e = 0; e < event_count && _good; e++)
+    {
+        std::uint64_t tick = 0, subject = 0, source = 0;
+        _good = _read[EVENTS] < _columns[EVENTS].size();
+        if(_good)
+        {
+            std::uint8_t type = _columns[EVENTS][_read[EVENTS]++];
+            _good = get_varint(EVENTS, tick) && get_varint(EVENTS, subject) && get_varint(EVENTS, source);
+            _events.push_back({(std::int32_t)tick, type, (std::uint32_t)subject, (std::uint32_t)source});
+        }
+    }
+
+    // Every chunk starts from zero
+    _chunk_ticks = ticks;
+    _chunk_tick = 0;
+    _chunk_subjects = (std::size_t)subjects;
+    _last_x.assign(_chunk_subjects, 0);
+    _last_y.assign(_chunk_subjects, 0);
+    _last_state.assign(_chunk_subjects, 0);
+    return _good;
+}
+
+bool RecordReader::get_varint(Column column, std::uint64_t& value)
+{
+    const std::vector<std::uint8_t>& data = _columns[column];
+    std::size_t& read = _read[column];
+    value = 0;
+    for(int shift = 0; shift < 64 && read < data.size(); shift += 7)
+    {
+        std::uint8_t byte = data[read++];
+        value |= (std::uint64_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RecordReader::get_zigzag(Column column, std::int64_t& value)
+{
+    std::uint64_t raw = 0;
+    if(!get_varint(column, raw))
+    {
+        return false;
+    }
+    value = (std::int64_t)(raw >> 1) ^ -(std::int64_t)(raw & 1);
+    return true;
+}
+
+}
@@ -0,0 +1,85 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "population.h"
+
+namespace corsim
+{
+
+//
+// A recorded tick as it is stored: positions quantised to round(position * position scale)
+//
+struct RecordedFrame
+{
+    int tick = 0;
+    std::vector<std::int32_t> x, y;
+    std::vector<std::uint8_t> state;  // SubjectStateFlags
+    std::vector<SubjectEvent> events; // since the previous recorded tick
+};
+
+/**
+ * Reads a file written by Recorder back, one recorded tick at a time. Only one chunk is kept in
+ * memory, see recorder.h for the format.
+ */
+class RecordReader
+{
+    public:
+        explicit RecordReader(const std::string& path);
+
+        //
+        // False when the file is not a recording of this version or a chunk could not be decoded, also when
+        // the sizes in its header do not fit the file
+        //
+        bool good() const { return _good; }
+        int position_scale() const { return _position_scale; }
+
+        //
+        // Decodes the next recorded tick into `frame`. Returns false at the end of the file, and when
+        // the file is damaged, which good() tells apart.
+        //
+        bool next(RecordedFrame& frame);
+
+    private:
+        enum Column { TICKS, XS, YS, STATES, EVENTS, COLUMN_COUNT };
+
+        bool read_chunk();
+        bool get_varint(Column column, std::uint64_t& value);
+        bool get_zigzag(Column column, std::int64_t& value);
+
+        std::ifstream _file;
+        bool _good = false;
+        int _position_scale = 1;
+        std::uint64_t _file_size = 0;
+
+        // Chunk being decoded
+        std::uint32_t _chunk_ticks = 0, _chunk_tick = 0;
+        std::size_t _chunk_subjects = 0;
+        std::vector<std::uint8_t> _columns[COLUMN_COUNT];
+        std::size_t _read[COLUMN_COUNT] = {};
+        std::vector<SubjectEvent> _events;
+        std::size_t _next_event = 0;
+        std::vector<std::int32_t> _last_x, _last_y;
+        std::vector<std::uint8_t> _last_state;
+};
+
+}
@@ -0,0 +1,267 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "recorder.h"
+#include <cstring>
+#include <math.h>
+
+// WASM builds without pthread support encode and write on the simulation thread
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+#define CORSIM_RECORDER_THREAD
+#endif
+
+namespace corsim
+{
+
+namespace
+{
+
+const std::uint32_t RECORDING_VERSION = 1;
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back((std::uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((std::uint8_t)value);
+}
+
+void put_zigzag(std::vector<std::uint8_t>& out, std::int64_t value)
+{
+    put_varint(out, ((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63));
+}
+
+template<typename T>
+void put_raw(std::ofstream& file, T value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}
+
+Recorder::Recorder(const std::string& path, int position_scale, int ticks_per_chunk, std::size_t frame_buffers) :
+    _file(path, std::ios::binary), _position_scale{position_scale > 0 ? position_scale : 1},
+    _ticks_per_chunk{ticks_per_chunk > 0 ? ticks_per_chunk : 1}, _frames(frame_buffers > 0 ? frame_buffers : 1)
+{
+    _file.write("CORSIMRC", 8);
+    put_raw(_file, RECORDING_VERSION);
+    put_raw(_file, (std::uint32_t)_position_scale);
+    _failed = !_file;
+
+    for(Frame& frame : _frames)
+    {
+        _free.push_back(&frame);
+    }
+
+#ifdef CORSIM_RECORDER_THREAD
+    _writer = std::thread(&Recorder::writer_loop, this);
+#endif
+}
+
+Recorder::~Recorder()
+{
+    close();
+}
+
+bool Recorder::good() const
+{
+    return !_failed;
+}
+
+bool Recorder::close()
+{
+    if(_closed)
+    {
+        return good();
+    }
+    _closed = true;
+
+#ifdef CORSIM_RECORDER_THREAD
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _queued.notify_all();
+    _writer.join();
+#endif
+    write_chunk();
+    return flush();
+}
+
+void Recorder::record(int tick, const Population& population, std::vector<SubjectEvent>& events)
+{
+    Frame* frame;
+    {
+        // Only waits when the writer is behind by all frame buffers
+        std::unique_lock<std::mutex> lock(_mutex);
+        _freed.wait(lock, [this]{ return !_free.empty(); });
+        frame = _free.back();
+        _free.pop_back();
+    }
+
+    frame->tick = tick;
+    frame->x.assign(population.x.begin(), population.x.end());
+    frame->y.assign(population.y.begin(), population.y.end());
+    frame->state.assign(population.state.begin(), population.state.end());
+    frame->events.swap(events);
+    events.clear();
+
+#ifdef CORSIM_RECORDER_THREAD
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.push_back(frame);
+    }
+    _queued.notify_one();
+#else
+    encode(*frame);
+    _free.push_back(frame);
+#endif
+}
+
+bool Recorder::flush()
+{
+#ifdef CORSIM_RECORDER_THREAD
+    std::unique_lock<std::mutex> lock(_mutex);
+    _freed.wait(lock, [this]{ return _queue.empty() && _writing == 0; });
+#endif
+    // The writer is idle, so the file can be touched from here
+    if(!_file.flush())
+    {
+        _failed = true;
+    }
+    return good();
+}
+
+void Recorder::writer_loop()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while(true)
+    {
+        _queued.wait(lock, [this]{ return _stop || !_queue.empty(); });
+        if(_queue.empty())
+        {
+            return; // stopped and everything is written
+        }
+
+        Frame* frame = _queue.front();
+        _queue.pop_front();
+        _writing++;
+        lock.unlock();
+
+        encode(*frame);
+
+        lock.lock();
+        _writing--;
+        _free.push_back(frame);
+        _freed.notify_all();
+    }
+}
+
+void Recorder::encode(const Frame& frame)
+{
+    std::size_t n = frame.x.size();
+    std::size_t chunk_bytes = _xs.size() + _ys.size() + _states.size() + _events.size();
+    if(_chunk_ticks > 0 && (_chunk_ticks == _ticks_per_chunk || n != _chunk_subjects || chunk_bytes >= MAX_CHUNK_BYTES))
+    {
+        write_chunk();
+    }
+
+    if(_chunk_ticks == 0)
+    {
+        // Every chunk starts from zero, so it can be decoded without the chunks before it
+        _chunk_subjects = n;
+        _last_x.assign(n, 0);
+        _last_y.assign(n, 0);
+        _last_state.assign(n, 0);
+    }
+
+    put_varint(_ticks, (std::uint32_t)frame.tick);
+
+    for(std::size_t i = 0; i < n; i++)
+    {
+        std::int32_t qx = (std::int32_t)lround(frame.x[i] * _position_scale);
+        put_zigzag(_xs, (std::int64_t)qx - _last_x[i]);
+        _last_x[i] = qx;
+    }
+    for(std::size_t i = 0; i < n; i++)
+    {
+        std::int32_t qy = (std::int32_t)lround(frame.y[i] * _position_scale);
+        put_zigzag(_ys, (std::int64_t)qy - _last_y[i]);
+        _last_y[i] = qy;
+    }
+
+    std::uint64_t zeros = 0;
+    for(std::size_t i = 0; i < n; i++)
+    {
+        std::uint8_t changed = frame.state[i] ^ _last_state[i];
+        _last_state[i] = frame.state[i];
+        if(changed == 0)
+        {
+            zeros++;
+            continue;
+        }
+        put_varint(_states, zeros);
+        _states.push_back(changed);
+        zeros = 0;
+    }
+    if(zeros > 0)
+    {
+        put_varint(_states, zeros);
+    }
+
+    for(const SubjectEvent& event : frame.events)
+    {
+        _events.push_back(event.type);
+        put_varint(_events, (std::uint32_t)event.tick);
+        put_varint(_events, event.subject);
+        put_varint(_events, event.source);
+    }
+    _chunk_events += frame.events.size();
+    _chunk_ticks++;
+}
+
+void Recorder::write_chunk()
+{
+    if(_chunk_ticks == 0)
+    {
+        return;
+    }
+
+    _file.write("CHNK", 4);
+    put_raw(_file, (std::uint32_t)_chunk_ticks);
+    put_raw(_file, (std::uint64_t)_chunk_subjects);
+    put_raw(_file, _chunk_events);
+    for(const std::vector<std::uint8_t>* column : {&_ticks, &_xs, &_ys, &_states, &_events})
+    {
+        put_raw(_file, (std::uint64_t)column->size());
+    }
+    for(std::vector<std::uint8_t>* column : {&_ticks, &_xs, &_ys, &_states, &_events})
+    {
+        _file.write(reinterpret_cast<const char*>(column->data()), column->size());
+        column->clear();
+    }
+    if(!_file)
+    {
+        _failed = true; // a full disk or the like, good() tells the simulation thread
+    }
+
+    _chunk_ticks = 0;
+    _chunk_events = 0;
+}
+
+}
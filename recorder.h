@@ -0,0 +1,128 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "population.h"
+
+namespace corsim
+{
+
+/**
+ * Streams the positions and states of all subjects, and the disease events, of every recorded
+ * tick to a file. The simulation only copies the columns it records into a free frame buffer,
+ * encoding and writing happens on a background thread. There is a fixed number of frame buffers,
+ * the simulation only waits when all of them are still queued for the writer.
+ *
+ * File format, little endian on the usual platforms (the byte order of the machine that wrote it):
+ *
+ *   header   "CORSIMRC", uint32 version, uint32 position scale
+ *   chunks   one after the other until the end of the file
+ *
+ * A chunk holds up to ticks_per_chunk recorded ticks, fewer when it grows past MAX_CHUNK_BYTES, and can
+ * be decoded on its own:
+ *
+ *   "CHNK", uint32 tick count, uint64 subject count, uint32 event count,
+ *   uint64 byte size of each of the columns below, then the columns:
+ *   ticks    varint tick of every recorded tick
+ *   x, y     for every tick, for every subject: zigzag varint of the quantised position
+ *            (round(position * scale)) minus the one of the previous tick in the chunk (0 before the first)
+ *   state    for every tick, the SubjectStateFlags of every subject XOR those of the previous tick in the
+ *            chunk, run length encoded: a varint number of zero bytes followed by the next byte, which is
+ *            left out when the zeros run to the last subject
+ *   events   for every event: byte SubjectEventType, varint tick, varint subject, varint source
+ *
+ * Subjects move less than a pixel per tick, so nearly all deltas fit in one byte.
+ */
+class Recorder
+{
+    public:
+        //
+        // Opens `path` for writing. position_scale is the number of quantisation steps per pixel.
+        //
+        explicit Recorder(const std::string& path, int position_scale = 16, int ticks_per_chunk = 64, std::size_t frame_buffers = 4);
+        ~Recorder(); // closes the recording, call close() first to find out whether that worked
+
+        //
+        // False once the file could not be opened or a write to it failed, on either thread
+        //
+        bool good() const;
+
+        //
+        // Records the subjects of tick `tick` and takes the events in `events`, leaving it empty
+        //
+        void record(int tick, const Population& population, std::vector<SubjectEvent>& events);
+
+        //
+        // Waits until everything recorded so far is written, returns good()
+        //
+        bool flush();
+
+        //
+        // Writes the last chunk and stops the writer, nothing can be recorded afterwards. Returns good().
+        //
+        bool close();
+
+    private:
+        struct Frame
+        {
+            int tick;
+            std::vector<double> x, y;
+            std::vector<std::uint8_t> state;
+            std::vector<SubjectEvent> events;
+        };
+
+        static const std::size_t MAX_CHUNK_BYTES = 16 << 20;
+
+        void writer_loop();
+        void encode(const Frame& frame);
+        void write_chunk();
+
+        std::ofstream _file;
+        int _position_scale, _ticks_per_chunk;
+
+        // Frames move from _free to _queue on the simulation thread and back on the writer thread
+        std::mutex _mutex;
+        std::condition_variable _queued, _freed;
+        std::deque<Frame*> _queue;
+        std::vector<Frame*> _free;
+        std::vector<Frame> _frames;
+        bool _stop = false;
+        bool _closed = false;
+        std::atomic<bool> _failed{false}; // set by whichever thread writes
+        std::size_t _writing = 0; // frames taken off the queue and not yet freed
+        std::thread _writer;
+
+        // Chunk being encoded, only used by the writer
+        std::size_t _chunk_subjects = 0;
+        int _chunk_ticks = 0;
+        std::uint32_t _chunk_events = 0;
+        std::vector<std::int32_t> _last_x, _last_y;
+        std::vector<std::uint8_t> _last_state;
+        std::vector<std::uint8_t> _ticks, _xs, _ys, _states, _events;
+};
+
+}
@@ -0,0 +1,89 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+
+namespace corsim
+{
+
+/**
+ * Counter-based random number generator (Widynski's "Squares"). A number is a pure
+ * function of the seed and a counter, there is no generator state that changes when
+ * a number is drawn. Every subject has its own stream (its index) and every tick its
+ * own block of draws, so subjects can draw in any order, on any thread, and a run is
+ * reproduced exactly by its seed.
+ */
+class CounterRng
+{
+    public:
+        explicit CounterRng(std::uint64_t seed = 0) : _seed{seed}, _key{key_from_seed(seed)} {}
+
+        std::uint64_t seed() const { return _seed; }
+
+        //
+        // 64 random bits for draw `draw` (0-255) of `stream` at `tick` (below 2^24)
+        //
+        std::uint64_t bits(std::uint32_t stream, std::uint32_t tick, std::uint32_t draw = 0) const
+        {
+            std::uint64_t counter = ((std::uint64_t)stream << 32) | ((std::uint64_t)(tick & 0xFFFFFF) << 8) | (draw & 0xFF);
+            return squares64(counter, _key);
+        }
+
+        //
+        // Uniformly distributed in [0, 1)
+        //
+        double uniform(std::uint32_t stream, std::uint32_t tick, std::uint32_t draw = 0) const
+        {
+            return (bits(stream, tick, draw) >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        //
+        // Uniformly distributed in [low, high)
+        //
+        double uniform(double low, double high, std::uint32_t stream, std::uint32_t tick, std::uint32_t draw = 0) const
+        {
+            return low + (high - low) * uniform(stream, tick, draw);
+        }
+
+    private:
+        static std::uint64_t squares64(std::uint64_t counter, std::uint64_t key)
+        {
+            std::uint64_t t, x, y, z;
+            y = x = counter * key;
+            z = y + key;
+            x = x * x + y; x = (x >> 32) | (x << 32);
+            x = x * x + z; x = (x >> 32) | (x << 32);
+            x = x * x + y; x = (x >> 32) | (x << 32);
+            t = x = x * x + z; x = (x >> 32) | (x << 32);
+            return t ^ ((x * x + y) >> 32);
+        }
+
+        // Squares needs a key with well mixed bits, so seeds like 0 or 1 are scrambled with splitmix64 first
+        static std::uint64_t key_from_seed(std::uint64_t seed)
+        {
+            std::uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return (z ^ (z >> 31)) | 1;
+        }
+
+        std::uint64_t _seed;
+        std::uint64_t _key;
+};
+
+}
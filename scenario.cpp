@@ -0,0 +1,82 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "scenario.h"
+#include "simulation.h"
+#include <math.h>
+
+namespace corsim
+{
+
+static DiseaseParameters disease_of(const Scenario& scenario)
+{
+    DiseaseParameters parameters;
+    parameters.infection2immunity_duration = scenario.infection2immunity_ticks * parameters.tick_speed;
+    parameters.immunity_duration = scenario.immunity_ticks * parameters.tick_speed;
+    return parameters;
+}
+
+void populate(Simulation& simulation, const Scenario& scenario)
+{
+    // ////////////////////////////////////////////////////////////
+    // B.3. preper immunity periods parameters
+    //
+    std::uint16_t disease = simulation.add_disease(disease_of(scenario));
+    // END: B.3. preper immunity periods parameters
+    // ////////////////////////////////////////////////////////////
+
+    //Random numbers are drawn from the counter based generator of the simulation, subject i uses
+    //stream i at tick 0 for its initial position and speed
+    const CounterRng& rng = simulation.rng();
+
+    int limitLockDown = (int)floor(scenario.subject_count * scenario.lockdown_fraction);
+    for(int i = 0; i < scenario.subject_count; i++)
+    {
+        double x = rng.uniform(1.0, scenario.width, i, 0, 0); //Randomly generate x position
+        double y = rng.uniform(1.0, scenario.height, i, 0, 1); //Randomly generate y position
+
+        // Added in place, su is a handle to the subject in the simulation
+        Subject su = simulation.subject(simulation.add_subject((int)x, (int)y, scenario.radius, false, disease));
+
+        su.set_dx(rng.uniform(-1.0, 1.0, i, 0, 2));
+        su.set_dy(rng.uniform(-1.0, 1.0, i, 0, 3));
+
+        if(i == scenario.subject_count - 1)
+        {
+            su.infect();
+            su.StartInfection2immunityPeriodOn(0); // first subject infected on simulation time 0
+        }
+
+        // A. bind the strategy, the first limitLockDown subjects are locked down
+        su.set_movement(i < limitLockDown ? MOVEMENT_LOCKDOWN : MOVEMENT_REGULAR);
+    }
+}
+
+void apply_measures(Simulation& simulation, const Scenario& scenario)
+{
+    std::uint16_t disease = simulation.add_disease(disease_of(scenario));
+
+    std::size_t count = simulation.subject_count();
+    std::size_t limitLockDown = (std::size_t)floor(count * scenario.lockdown_fraction);
+    for(std::size_t i = 0; i < count; i++)
+    {
+        Subject su = simulation.subject(i);
+        su.set_disease(disease);
+        su.set_movement(i < limitLockDown ? MOVEMENT_LOCKDOWN : MOVEMENT_REGULAR);
+    }
+}
+
+}
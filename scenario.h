@@ -0,0 +1,55 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+
+namespace corsim
+{
+
+class Simulation;
+
+/**
+ * The parameters of the initial population of a simulation. The defaults are the
+ * setup of the browser build: 200 subjects on 800x500 of which 75% are in lockdown.
+ */
+struct Scenario
+{
+    int subject_count = 200;
+    int width = 800;
+    int height = 500;
+    int radius = 2;
+    double lockdown_fraction = 0.75;   // fraction of the subjects that stand still
+    int infection2immunity_ticks = 90; // B.3. ticks from infection until immunity
+    int immunity_ticks = 210;          // B.3. ticks the immunity lasts
+};
+
+//
+// Adds the subjects of `scenario` to `simulation`. Positions and speeds are drawn from the counter based
+// generator of the simulation, so set its seed first. The simulation should have the width and height of
+// the scenario. The last subject is infected at time 0.
+//
+void populate(Simulation& simulation, const Scenario& scenario);
+
+//
+// Changes the lockdown and B.3. immunity periods of a simulation set up by populate to those of `scenario`, as
+// if they were its measures from now on. Subjects are locked down in the same order as populate does, periods
+// that already started keep their end. The number of subjects and their radius stay as they are.
+//
+void apply_measures(Simulation& simulation, const Scenario& scenario);
+
+}
@@ -0,0 +1,33 @@
+# Corona Simulation - basic simulation of a human transmissable virus
+# Copyright (C) 2020  wbrinksma
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# python3 -m http.server with the headers that make a page cross-origin isolated, browsers only
+# give such pages SharedArrayBuffer, which the worker build needs. Serves the current directory.
+
+import http.server
+import sys
+
+
+class IsolatedRequestHandler(http.server.SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        super().end_headers()
+
+
+if __name__ == "__main__":
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 8000
+    http.server.test(HandlerClass=IsolatedRequestHandler, port=port)
@@ -19,22 +19,228 @@
 #include "MovementStrategy/RegularMovementStrategy.h"
 
 #include "simulation.h"
+#include "checkpoint.h"
+#include "narrow_phase.h"
+#include "profiler.h"
 #include <iostream>
+#ifdef __EMSCRIPTEN__
 #include <emscripten.h>
+#endif
 #include <math.h>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <fstream>
 
 namespace corsim
 {
 
+double distance(const Population& p, std::size_t i1, std::size_t i2)
+{
+    return sqrt(pow(p.x[i1] - p.x[i2],2) + pow(p.y[i1] - p.y[i2],2));
+}
+
+namespace
+{
+
+// Draw of a subject on every tick that decides whether its contacts infect it, see contact_pass. Ticks start at
+// 1, so it never meets the draws of tick 0 that set up the population.
+const std::uint32_t CONTACT_DRAW = 0;
+
+// Directions of both subjects after they collided
+struct Exchange
+{
+    double dx1, dy1, dx2, dy2;
+};
+
+//
+// The subjects swap the components of their directions along the line through their centres, the other
+// components stay. theta1 and theta2 are the directions, phi the angle of the contact normal.
+//
+Exchange trigonometric_exchange(const Population& p, std::size_t i1, std::size_t i2)
+{
+    double theta1 = atan2(p.dy[i1], p.dx[i1]);
+    double theta2 = atan2(p.dy[i2], p.dx[i2]);
+    double phi = atan2(p.x[i1] - p.x[i2], p.y[i1] - p.y[i2]);
+
+    double dx1F = ((2.0*cos(theta2 - phi)) / 2) * cos(phi) + sin(theta1-phi) * cos(phi+M_PI/2.0);
+    double dy1F = ((2.0*cos(theta2 - phi)) / 2) * sin(phi) + sin(theta1-phi) * sin(phi+M_PI/2.0);
+
+    double dx2F = ((2.0*cos(theta1 - phi)) / 2) * cos(phi) + sin(theta2-phi) * cos(phi+M_PI/2.0);
+    double dy2F = ((2.0*cos(theta1 - phi)) / 2) * sin(phi) + sin(theta2-phi) * sin(phi+M_PI/2.0);
+
+    return {dx1F, dy1F, dx2F, dy2F};
+}
+
+//
+// Unit vector of (x, y), (1, 0) for the zero vector like the angle atan2 gives it
+//
+void normalise(double x, double y, double& ux, double& uy)
+{
+    double length = sqrt(x * x + y * y);
+    if(length > 0)
+    {
+        ux = x / length;
+        uy = y / length;
+    }
+    else
+    {
+        ux = 1;
+        uy = 0;
+    }
+}
+
+//
+// Same exchange without angles. The unit directions u1 and u2 are split along the normal n and the tangent t
+// of the contact: u1' = (u2.n) n + (u1.t) t and u2' = (u1.n) n + (u2.t) t. phi above is the angle of
+// (y1 - y2, x1 - x2), so that is the normal.
+//
+Exchange vector_exchange(const Population& p, std::size_t i1, std::size_t i2)
+{
+    double u1x, u1y, u2x, u2y, nx, ny;
+    normalise(p.dx[i1], p.dy[i1], u1x, u1y);
+    normalise(p.dx[i2], p.dy[i2], u2x, u2y);
+    normalise(p.y[i1] - p.y[i2], p.x[i1] - p.x[i2], nx, ny);
+    double tx = -ny, ty = nx;
+
+    double n1 = u1x * nx + u1y * ny, t1 = u1x * tx + u1y * ty;
+    double n2 = u2x * nx + u2y * ny, t2 = u2x * tx + u2y * ty;
+    return {n2 * nx + t1 * tx, n2 * ny + t1 * ty, n1 * nx + t2 * tx, n1 * ny + t2 * ty};
+}
+
+}
+
 Simulation::Simulation(int width, int height, std::unique_ptr<Canvas> canvas, std::unique_ptr<StatisticsHandler> sh) : 
     _sim_width{width}, _sim_height{height}, _canvas{std::move(canvas)}, _sh{std::move(sh)} {}
 
 void Simulation::add_subject(Subject&& s)
 {
-    this->_subjects.emplace_back(std::move(s));
+    this->_subjects.append(s.population(), s.index());
+}
+
+void Simulation::clear()
+{
+    _subjects.clear();
+    _counter = 0;
+    _events.clear();
+}
+
+std::size_t Simulation::add_subject(double x, double y, int radius, bool infected, std::uint16_t disease)
+{
+    return _subjects.add(x, y, radius, infected, disease);
+}
+
+std::uint16_t Simulation::add_disease(const DiseaseParameters& parameters)
+{
+    return _subjects.add_disease(parameters);
 }
 
-void Simulation::run()
+void Simulation::set_seed(std::uint64_t seed)
+{
+    _rng = CounterRng(seed);
+}
+
+const CounterRng& Simulation::rng() const
+{
+    return _rng;
+}
+
+bool Simulation::save_checkpoint(std::vector<char>& out) const
+{
+    CheckpointHeader header{};
+    header.seed = _rng.seed();
+    header.counter = _counter;
+    header.width = _sim_width;
+    header.height = _sim_height;
+    return write_checkpoint(_subjects, header, out);
+}
+
+bool Simulation::save_checkpoint(const std::string& path) const
+{
+    std::vector<char> data;
+    if(!save_checkpoint(data))
+    {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(data.data(), data.size());
+    return (bool)file;
+}
+
+bool Simulation::load_checkpoint(const char* data, std::size_t size)
+{
+    Population population;
+    CheckpointHeader header;
+    if(!read_checkpoint(data, size, population, header) || header.width != _sim_width || header.height != _sim_height)
+    {
+        return false;
+    }
+
+    _subjects = std::move(population);
+    _counter = header.counter;
+    _rng = CounterRng(header.seed);
+    return true;
+}
+
+bool Simulation::load_checkpoint(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        return false;
+    }
+
+    std::vector<char> data((std::size_t)file.tellg());
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    return file && load_checkpoint(data.data(), data.size());
+}
+
+void Simulation::set_recorder(std::unique_ptr<Recorder> recorder, int interval)
+{
+    _recorder = std::move(recorder);
+    _record_interval = std::max(interval, 1);
+    _events.clear();
+}
+
+bool Simulation::finish_recording()
+{
+    bool written = !_recorder || _recorder->close();
+    set_recorder(nullptr);
+    return written;
+}
+
+void Simulation::set_publisher(std::unique_ptr<StatePublisher> publisher)
+{
+    _publisher = std::move(publisher);
+}
+
+std::size_t Simulation::subject_count() const
+{
+    return _subjects.size();
+}
+
+const Population& Simulation::population() const
+{
+    return _subjects;
+}
+
+Subject Simulation::subject(std::size_t index)
+{
+    return Subject(_subjects, index);
+}
+
+void Simulation::set_schedule(const Schedule& schedule)
+{
+    _schedule = schedule;
+    _schedule.ticks_per_frame = std::max(_schedule.ticks_per_frame, 0);
+    _schedule.frame_interval = std::max(_schedule.frame_interval, 0);
+    _schedule.stats_interval = std::max(_schedule.stats_interval, 1);
+}
+
+void Simulation::run(int tick_count)
 {
       if(running)
     {
@@ -43,209 +249,864 @@ void Simulation::run()
 
     running = true;
 
-    while(true)
+    int remaining = tick_count;
+    while(tick_count < 0 || remaining > 0)
+    {
+#if (defined(__EMSCRIPTEN__) && defined(CORSIM_ASYNCIFY)) || defined(CORSIM_WORKER)
+        auto start = std::chrono::steady_clock::now();
+#endif
+        int ticks = frame(remaining);
+        if(tick_count >= 0)
+        {
+            remaining -= ticks;
+        }
+
+        // Only the browser build is paced, native builds run as fast as possible
+#if defined(__EMSCRIPTEN__) && defined(CORSIM_ASYNCIFY)
+        // Wait for what is left of the frame interval, but always give the browser a chance to draw
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        emscripten_sleep(std::max<long long>(_schedule.frame_interval - elapsed, 0));
+#elif defined(CORSIM_WORKER)
+        // A worker can block without holding up the page
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        std::this_thread::sleep_for(std::chrono::milliseconds(_schedule.frame_interval) - elapsed);
+#endif
+    }
+
+    _sh.get()->flush();
+    running = false;
+}
+
+#ifdef __EMSCRIPTEN__
+void Simulation::run_in_main_loop(int tick_count)
+{
+    if(running || tick_count == 0)
+    {
+        return;
+    }
+
+    running = true;
+    _main_loop_remaining = tick_count;
+    _main_loop_next_frame = std::chrono::steady_clock::now();
+
+    // fps 0 lets the browser call back on requestAnimationFrame, the frame interval is kept by main_loop_frame.
+    // simulate_infinite_loop leaves the stack of the caller, and so the simulation, as it is.
+    emscripten_set_main_loop_arg(&Simulation::main_loop_frame, this, 0, true);
+}
+
+void Simulation::main_loop_frame(void* simulation)
+{
+    Simulation& s = *static_cast<Simulation*>(simulation);
+
+    auto now = std::chrono::steady_clock::now();
+    if(now < s._main_loop_next_frame)
+    {
+        return;
+    }
+    // Frames start on a fixed beat, but after a long frame the simulation does not try to catch up
+    s._main_loop_next_frame = std::max(s._main_loop_next_frame + std::chrono::milliseconds(s._schedule.frame_interval), now);
+
+    int ticks = s.frame(s._main_loop_remaining);
+    if(s._main_loop_remaining >= 0)
     {
-        this->tick();
-        emscripten_sleep(tick_speed);
+        s._main_loop_remaining -= ticks;
+        if(s._main_loop_remaining <= 0)
+        {
+            // The main loop never returns to the caller of run_in_main_loop, so the run is finished from here
+            emscripten_cancel_main_loop();
+            s._sh.get()->flush();
+            s.running = false;
+        }
     }
 }
+#else
+void Simulation::run_in_main_loop(int tick_count)
+{
+    run(tick_count);
+}
+#endif
 
-int counter  = 0;
+int Simulation::frame(int max_ticks)
+{
+    int ticks = 0;
+
+    if(_schedule.ticks_per_frame > 0)
+    {
+        while(ticks < _schedule.ticks_per_frame && (max_ticks < 0 || ticks < max_ticks))
+        {
+            tick();
+            ticks++;
+            CORSIM_PROFILE_SAMPLE();
+        }
+    }
+    else
+    {
+        // Uncapped, tick until the frame interval is used up
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_schedule.frame_interval);
+        while((max_ticks < 0 || ticks < max_ticks) && (ticks == 0 || std::chrono::steady_clock::now() < deadline))
+        {
+            tick();
+            ticks++;
+            CORSIM_PROFILE_SAMPLE();
+        }
+    }
+
+    if(_schedule.draw)
+    {
+        CORSIM_PROFILE_SCOPE("draw");
+        draw_to_canvas();
+        if(_publisher)
+        {
+            _publisher->publish(_counter, _subjects);
+        }
+    }
+    CORSIM_PROFILE_SAMPLE();
+    return ticks;
+}
+
+int Simulation::counter() const
+{
+    return _counter;
+}
+
+std::size_t Simulation::pending_transitions() const
+{
+    return _subjects.pending_timers();
+}
+
+const Compartments& Simulation::compartments() const
+{
+    return _subjects.compartments();
+}
+
+void Simulation::set_broad_phase(BroadPhase broad_phase)
+{
+    _broad_phase = broad_phase;
+}
+
+void Simulation::set_collision_response(CollisionResponse response)
+{
+    _collision_response = response;
+}
+
+double Simulation::collision_response_deviation() const
+{
+    return _collision_deviation;
+}
+
+void Simulation::record_deviation(double difference)
+{
+    double largest = _collision_deviation;
+    while(difference > largest && !_collision_deviation.compare_exchange_weak(largest, difference))
+    {
+    }
+}
+
+void Simulation::set_infection_radius(double radius)
+{
+    _infection_radius = std::max(radius, 0.0);
+}
+
+void Simulation::set_transmission_probability(double probability)
+{
+    _transmission_probability = std::min(std::max(probability, 0.0), 1.0);
+}
+
+void Simulation::set_thread_count(unsigned thread_count)
+{
+    _pool = thread_count > 0 ? std::make_unique<ThreadPool>(thread_count) : nullptr;
+}
+
+//
+// Splits the subjects into consecutive ranges and calls f(range, begin, end) for each of them, on the
+// thread pool when ticking in parallel.
+//
+void Simulation::for_each_range(const std::function<void(std::size_t, std::size_t, std::size_t)>& f)
+{
+    std::size_t n = _subjects.size();
+    std::size_t ranges = _pool ? _pool->thread_count() * 4 : 1;
+
+    auto task = [&](std::size_t r)
+    {
+        f(r, n * r / ranges, n * (r + 1) / ranges);
+    };
+
+    if(_pool)
+    {
+        _pool->run(ranges, task);
+    }
+    else
+    {
+        task(0);
+    }
+}
 
 void Simulation::tick()
 {
-   counter++;
+    CORSIM_PROFILE_SCOPE("tick");
+   _counter++;
 
     double dt = tick_speed / 10.0;
+    Population& p = _subjects;
+    bool parallel = _pool && _broad_phase == BroadPhase::UniformGrid;
 
-    std::vector<Subject*> collision_checker;
+    update_partition();
+    p.event_log = _recorder ? &_events : nullptr;
 
-    for(Subject& s : _subjects)
     {
+        CORSIM_PROFILE_SCOPE("tick.subjects");
+
         // ----------------------------------------
-        // B.3. promote immunity strategy one tick
-        s.DoTick(counter);
+        // B.3. promote immunity strategy one tick, only for the subjects that have a transition due
+        p.tick_timers(_counter);
         // ----------------------------------------
 
-        collision_checker.emplace_back(&s);
+        for_each_range([&](std::size_t, std::size_t begin, std::size_t end)
+        {
+            for(std::size_t i = begin; i < end; i++)
+            {
+                // Sleeping subjects cannot move, they keep their speed until they wake up
+                if(!p.standstill[i])
+                {
+                    wall_collision(i);
+                }
+            }
+        });
+    }
 
-        wall_collision(s);
+    {
+        CORSIM_PROFILE_SCOPE("tick.collisions");
+        if(parallel)
+        {
+            strip_collisions(_counter);
+        }
+        else if(_broad_phase == BroadPhase::UniformGrid)
+        {
+            grid_collisions(_counter);
+        }
+        else
+        {
+            brute_force_collisions(_counter);
+        }
     }
 
-    for(int i = collision_checker.size()-1; i < collision_checker.size(); i--)
+    if(_infection_radius > 0)
     {
-        Subject* current_checking = collision_checker.at(i);
+        CORSIM_PROFILE_SCOPE("tick.contacts");
+        contact_pass(_counter);
+    }
 
-        collision_checker.erase(collision_checker.end());
+    {
+        CORSIM_PROFILE_SCOPE("tick.integrate");
 
-        for(Subject* s : collision_checker)
+        // A. custom strategies get to steer their subjects, in subject order because they can have state
+        for(std::size_t i : _custom)
         {
-        // ----------------------------------------
-        // B.3. subject_collision testing will consider immunity strategy one tick
-            subject_collision(*current_checking, *s, counter);
-        // ----------------------------------------
+            bool infected = p.infected(i);
+            p.custom_strategy(i)->Move(p.x[i], p.y[i], p.dx[i], p.dy[i], infected);
+        }
+
+        for_each_range([&](std::size_t, std::size_t begin, std::size_t end)
+        {
+            for(std::size_t i = begin; i < end; i++)
+            {
+                //
+                // A. this is the only point where LockDown / Regular movement startegy is applied!!!
+                //
+                // subjects whose strategy stands still are not moved.
+                //
+                if(!p.standstill[i])
+                {
+                    p.x[i] += p.dx[i] * dt;
+                    p.y[i] += p.dy[i] * dt;
+                }
+            }
+        });
+    }
+
+    if(_recorder && _counter % _record_interval == 0)
+    {
+        CORSIM_PROFILE_SCOPE("tick.record");
+        _recorder->record(_counter, p, _events);
+    }
+
+    if(_counter % _schedule.stats_interval == 0)
+    {
+        CORSIM_PROFILE_SCOPE("tick.statistics");
+        // time is reported in seconds of simulated time
+        _sh.get()->communicate_compartments(_counter / (1000 / tick_speed), p.compartments());
+    }
+}
+
+//
+// Every moving subject is checked against all moving subjects before it and against all sleeping
+// subjects. The last subject is checked first, the order in which the pairs are visited matters because
+// a collision moves the subjects involved. Sleeping subjects never move, so a pair of them only passes
+// on infections, after all moving subjects are done.
+//
+void Simulation::brute_force_collisions(int counter)
+{
+    const Population& p = _subjects;
+    for(std::size_t i = p.size(); i-- > 0;)
+    {
+        if(p.standstill[i])
+        {
+            continue;
+        }
+
+        for(std::size_t j = 0; j < p.size(); j++)
+        {
+            if(j != i && (j < i || p.standstill[j]))
+            {
+                // ----------------------------------------
+                // B.3. subject_collision testing will consider immunity strategy one tick
+                subject_collision(std::max(i, j), std::min(i, j), counter);
+                // ----------------------------------------
+            }
         }
     }
 
-    int numberInfected = 0;
+    for(std::size_t i = p.size(); i-- > 0;)
+    {
+        for(std::size_t j = 0; j < i && p.standstill[i]; j++)
+        {
+            if(p.standstill[j] && distance(p, i, j) < p.radius[i] + p.radius[j])
+            {
+                transmit(i, j, counter, nullptr);
+            }
+        }
+    }
+}
+
+//
+// Same visiting order as brute_force_collisions, but only for pairs in neighbouring cells of a grid
+// with cells twice the largest radius wide. Moving subjects are put in a grid every tick, the sleeping
+// subjects are in a grid of their own. Collisions push subjects, so the grid is kept up to date with every
+// push and the neighbours of a subject are looked up again when it changes cell itself. That way every
+// pair the brute force loop would find overlapping is visited.
+//
+void Simulation::grid_collisions(int counter)
+{
+    Population& p = _subjects;
+    _grid.build(p.size(), _moving, p.x.data(), p.y.data(), _cell_size, _sim_width, _sim_height);
 
-   for(Subject& s : _subjects)
+    for(std::size_t m = _moving.size(); m-- > 0;)
     {
-        //
-        // A. this is the only point where LockDown / Regular movement startegy is applied!!!
-        //
-        // set_x , set_y member functions will consider lockdown strategy per instance.
-        //
-        s.set_x(s.x() + s.dx() * dt);
-        s.set_y(s.y() + s.dy() * dt);
+        std::size_t i = _moving[m];
+        _neighbours.clear();
+        collision_candidates(i, _grid.cell_of_item(i), _neighbours);
+
+        std::size_t k = 0;
+        while(k < _neighbours.size())
+        {
+            // Only overlapping pairs collide, the others are skipped without being looked at one by one
+            k += first_overlap(p, p.x[i], p.y[i], p.radius[i], _neighbours.data() + k, _neighbours.size() - k);
+            if(k == _neighbours.size())
+            {
+                break;
+            }
+
+            std::size_t j = _neighbours[k++];
+            subject_collision(std::max(i, j), std::min(i, j), counter);
+
+            if(!p.standstill[j])
+            {
+                _grid.move(j, p.x[j], p.y[j]);
+            }
+            if(_grid.move(i, p.x[i], p.y[i]))
+            {
+                // Continue with the subjects after j around the new position
+                _neighbours.clear();
+                collision_candidates(i, _grid.cell_of_item(i), _neighbours);
+                _neighbours.erase(_neighbours.begin(), std::upper_bound(_neighbours.begin(), _neighbours.end(), j));
+                k = 0;
+            }
+        }
+    }
+
+    sleeping_contacts(counter, nullptr);
+}
+
+//
+// Moving subjects before moving subject i and all sleeping subjects in or around `cell`, in ascending order
+//
+void Simulation::collision_candidates(std::size_t i, int cell, std::vector<std::size_t>& out) const
+{
+    std::size_t first = out.size();
+    _grid.lower_neighbours(i, out);
+    if(!_sleeping.empty())
+    {
+        std::size_t middle = out.size();
+        _sleeping_grid.cell_neighbours(cell, out);
+        std::inplace_merge(out.begin() + first, out.begin() + middle, out.end());
+    }
+}
+
+//
+// Parallel version of grid_collisions. The area is split into vertical strips of STRIP_COLUMNS grid
+// columns and every moving subject belongs to the strip of the cell it is in when the grid is built. A
+// pair belongs to the strip of the moving subject that looks up its neighbours: the higher index one
+// when both move.
+//
+// Neighbours are at most one cell away, so a strip only touches subjects of itself and the strips on
+// either side. Strips that are three apart never touch the same subjects: the strips are processed
+// in three rounds (strip % 3 == 0, 1, 2) and the strips in a round run in parallel. Within a strip
+// pairs are visited in the same order as the serial loop.
+//
+// Infections that happen during the rounds, and those between sleeping subjects, are collected and
+// applied afterwards in strip order, so whether a pair infects depends only on the state at the start of the tick and not on
+// which strip got there first. Pairs are looked up around the cells the subjects were in when the
+// grid was built; a pair that only starts to overlap because of a push-out is handled next tick.
+//
+// None of this depends on the number of threads, so results are the same for any thread count of 1 or more. They
+// differ from those of grid_collisions, which visits pairs in another order and infects right away.
+//
+void Simulation::strip_collisions(int counter)
+{
+    Population& p = _subjects;
+    _grid.build(p.size(), _moving, p.x.data(), p.y.data(), _cell_size, _sim_width, _sim_height);
+
+    std::size_t strips = (_grid.columns() + STRIP_COLUMNS - 1) / STRIP_COLUMNS;
+    _strip_start.assign(strips + 1, 0);
+    _strip_items.resize(_moving.size());
+    _strip_neighbours.resize(strips);
+    _strip_infections.resize(strips);
+
+    for(std::size_t i : _moving)
+    {
+        _strip_start[_grid.column_of(i) / STRIP_COLUMNS + 1]++;
+    }
+    for(std::size_t s = 1; s <= strips; s++)
+    {
+        _strip_start[s] += _strip_start[s - 1];
+    }
+    // Filling in index order keeps every strip sorted
+    _strip_cursor.assign(_strip_start.begin(), _strip_start.end() - 1);
+    for(std::size_t i : _moving)
+    {
+        _strip_items[_strip_cursor[_grid.column_of(i) / STRIP_COLUMNS]++] = i;
+    }
+
+    for(std::size_t round = 0; round < 3; round++)
+    {
+        _pool->run((strips + 2 - round) / 3, [&](std::size_t k)
+        {
+            std::size_t s = round + 3 * k;
+            std::vector<std::size_t>& neighbours = _strip_neighbours[s];
+            _strip_infections[s].clear();
+
+            for(int item = _strip_start[s + 1]; item-- > _strip_start[s];)
+            {
+                std::size_t i = _strip_items[item];
+                neighbours.clear();
+                collision_candidates(i, _grid.cell_of_item(i), neighbours);
+
+                // A collision pushes i, so the candidates after an overlapping one are tested again from where i is now
+                std::size_t n = 0;
+                while((n += first_overlap(p, p.x[i], p.y[i], p.radius[i], neighbours.data() + n, neighbours.size() - n))
+                    < neighbours.size())
+                {
+                    std::size_t j = neighbours[n++];
+                    subject_collision(std::max(i, j), std::min(i, j), counter, &_strip_infections[s]);
+                }
+            }
+        });
+    }
+
+    _sleeping_infections.clear();
+    sleeping_contacts(counter, &_sleeping_infections);
+
+    // Infections are collected in pairs, the other subject of the pair is the one that passed it on
+    auto apply = [&](const std::vector<std::size_t>& infections)
+    {
+        for(std::size_t k = 0; k < infections.size(); k++)
+        {
+            std::size_t i = infections[k];
+            if(!p.immune(i))
+            {
+                if(p.event_log != nullptr && !p.infected(i))
+                {
+                    std::size_t source = infections[k ^ 1];
+                    p.event_log->push_back({counter, EVENT_INFECTION, (std::uint32_t)i, (std::uint32_t)source});
+                }
+                p.infect(i);
+                p.start_infection2immunity_period(i, counter);
+            }
+        }
+    };
+
+    for(const std::vector<std::size_t>& infections : _strip_infections)
+    {
+        apply(infections);
+    }
+    apply(_sleeping_infections);
+}
+
+//
+// Sleeping subjects never move, so which of them overlap only changes with the partition. Those pairs
+// only pass on infections.
+//
+void Simulation::sleeping_contacts(int counter, std::vector<std::size_t>* deferred_infections)
+{
+    for(const std::pair<std::size_t, std::size_t>& pair : _sleeping_pairs)
+    {
+        transmit(pair.first, pair.second, counter, deferred_infections);
+    }
+}
+
+//
+// Infects the susceptible subjects closer than the infection radius to an infected subject. Only the subjects
+// infected at the start of the pass infect, so the pass does not depend on the order the infected subjects are
+// visited in: their contacts are collected for ranges of them, on the thread pool when there is one, and applied
+// afterwards in subject order. A subject draws once whether it is infected, whatever the number of contacts, so the
+// result is the same for any thread count. Around every infected subject the grids are searched as far as the
+// infection radius reaches, so the pass costs as much as there are infected subjects and subjects around them.
+//
+void Simulation::contact_pass(int counter)
+{
+    Population& p = _subjects;
+    _frontier.assign(p.infected_subjects().begin(), p.infected_subjects().end());
+    if(_frontier.empty())
+    {
+        return;
+    }
+
+    bool grid = _broad_phase == BroadPhase::UniformGrid;
+    if(grid && _pool)
+    {
+        // The parallel tick leaves pushed subjects in the cell they were in when the grid was built
+        for(std::size_t i : _moving)
+        {
+            _grid.move(i, p.x[i], p.y[i]);
+        }
+    }
+
+    std::size_t n = _frontier.size();
+    std::size_t ranges = _pool ? std::min<std::size_t>(_pool->thread_count() * 4, n) : 1;
+    _contacts.resize(ranges);
+    _contact_neighbours.resize(ranges);
+
+    auto task = [&](std::size_t r)
+    {
+        std::vector<std::pair<std::size_t, std::size_t>>& contacts = _contacts[r];
+        std::vector<std::size_t>& candidates = _contact_neighbours[r];
+        contacts.clear();
 
-        if(s.infected())
+        for(std::size_t f = n * r / ranges; f < n * (r + 1) / ranges; f++)
         {
-            numberInfected++;
+            std::size_t i = _frontier[f];
+            candidates.clear();
+            if(grid)
+            {
+                _grid.neighbours(p.x[i], p.y[i], _infection_radius, candidates);
+                _sleeping_grid.neighbours(p.x[i], p.y[i], _infection_radius, candidates);
+            }
+            else
+            {
+                for(std::size_t j = 0; j < p.size(); j++)
+                {
+                    candidates.push_back(j);
+                }
+            }
+
+            for(std::size_t j : candidates)
+            {
+                if(!p.infected(j) && !p.immune(j) && distance(p, i, j) < _infection_radius)
+                {
+                    contacts.emplace_back(j, i);
+                }
+            }
         }
+    };
+
+    if(_pool)
+    {
+        _pool->run(ranges, task);
+    }
+    else
+    {
+        task(0);
     }
 
-    if(counter % 30 == 0)
+    _contact_pairs.clear();
+    for(const std::vector<std::pair<std::size_t, std::size_t>>& contacts : _contacts)
     {
-        _sh.get()->communicate_number_infected(counter/30,numberInfected);
+        _contact_pairs.insert(_contact_pairs.end(), contacts.begin(), contacts.end());
     }
-    
+    std::sort(_contact_pairs.begin(), _contact_pairs.end());
+
+    for(std::size_t k = 0; k < _contact_pairs.size();)
+    {
+        // The contacts of a subject are next to each other, the one with the lowest index is named as the source
+        std::size_t j = _contact_pairs[k].first, source = _contact_pairs[k].second;
+        std::size_t first = k;
+        while(k < _contact_pairs.size() && _contact_pairs[k].first == j)
+        {
+            k++;
+        }
+
+        if(_transmission_probability < 1 &&
+            _rng.uniform((std::uint32_t)j, counter, CONTACT_DRAW) >= 1 - pow(1 - _transmission_probability, k - first))
+        {
+            continue;
+        }
 
-    draw_to_canvas();
+        if(p.event_log != nullptr)
+        {
+            p.event_log->push_back({counter, EVENT_INFECTION, (std::uint32_t)j, (std::uint32_t)source});
+        }
+        p.infect(j);
+        p.start_infection2immunity_period(j, counter);
+    }
 }
 
 void Simulation::draw_to_canvas()
 {
+    const Population& p = _subjects;
+
     _canvas.get()->clear();
     _canvas.get()->draw_rectangle(0,0,1,_sim_height,BLACK);
     _canvas.get()->draw_rectangle(0,0,_sim_width,1,BLACK);
     _canvas.get()->draw_rectangle(0,_sim_height-1,_sim_width,1,BLACK);
     _canvas.get()->draw_rectangle(_sim_width-1,0,1,_sim_height,BLACK);
 
-    for(Subject& s : _subjects)
+    // Lockdown rings first so they end up underneath all subjects
+    for(std::size_t i = 0; i < p.size(); i++)
     {
-        CanvasColor c = BLUE;
-
-        if(s.infected())
+        if (p.standstill[i])
         {
-            c = RED;
+            CanvasColor c2 = MAGENTA;
+            _canvas.get()->draw_ellipse(p.x[i], p.y[i], p.radius[i] + 2 , c2);
         }
+    }
+
+    for(std::size_t i = 0; i < p.size(); i++)
+    {
+        CanvasColor c = BLUE;
 
-        if (s.isStandStill())
+        if(p.infected(i))
         {
-            CanvasColor c2 = MAGENTA;
-            _canvas.get()->draw_ellipse(s.x(), s.y(), s.radius() + 2 , c2);
+            c = RED;
         }
 
-        if(s.isImmunityOn())
+        if(p.immune(i))
         {
             c = GREEN;
         }
 
-        _canvas.get()->draw_ellipse(s.x(), s.y(), s.radius(), c);
-
+        _canvas.get()->draw_ellipse(p.x[i], p.y[i], p.radius[i], c);
     }
+
+    CORSIM_PROFILE_SCOPE("draw.present");
+    _canvas.get()->present();
 }
 
-void Simulation::wall_collision(Subject& s)
+void Simulation::wall_collision(std::size_t i)
 {
-    if (s.x() - s.radius() + s.dx() < 0 ||
-        s.x() + s.radius() + s.dx() > _sim_width) {
-        s.set_dx(s.dx() * -1);
+    Population& p = _subjects;
+    double r = p.radius[i];
+
+    if (p.x[i] - r + p.dx[i] < 0 ||
+        p.x[i] + r + p.dx[i] > _sim_width) {
+        p.dx[i] *= -1;
     }
-    if (s.y() - s.radius() + s.dy() < 0 ||
-        s.y() + s.radius() + s.dy() > _sim_height) {
-        s.set_dy(s.dy() * -1);
+    if (p.y[i] - r + p.dy[i] < 0 ||
+        p.y[i] + r + p.dy[i] > _sim_height) {
+        p.dy[i] *= -1;
     }
-    if (s.y() + s.radius() > _sim_height) {
-        s.set_y(_sim_height - s.radius());
+    if (p.y[i] + r > _sim_height) {
+        p.set_y(i, _sim_height - r);
     }
-    if (s.y() - s.radius() < 0) {
-        s.set_y(s.radius());
+    if (p.y[i] - r < 0) {
+        p.set_y(i, r);
     }
-    if (s.x() + s.radius() > _sim_width) {
-        s.set_x(_sim_width - s.radius());
+    if (p.x[i] + r > _sim_width) {
+        p.set_x(i, _sim_width - r);
     }
-    if (s.x() - s.radius() < 0) {
-        s.set_x(s.radius());
+    if (p.x[i] - r < 0) {
+        p.set_x(i, r);
     }
 }
 
-double distance(Subject& s1, Subject& s2)
+void Simulation::subject_collision(std::size_t i1, std::size_t i2, const int& _counterIn, std::vector<std::size_t>* deferred_infections)
 {
-    return sqrt(pow(s1.x() - s2.x(),2) + pow(s1.y() - s2.y(),2));
+    Population& p = _subjects;
+    double dist = distance(p, i1, i2);
+
+    if(dist < p.radius[i1] + p.radius[i2])
+    {
+        transmit(i1, i2, _counterIn, deferred_infections);
+
+        Exchange e = _collision_response == CollisionResponse::Vector ? vector_exchange(p, i1, i2) :
+            trigonometric_exchange(p, i1, i2);
+        if(_collision_response == CollisionResponse::Compare)
+        {
+            Exchange v = vector_exchange(p, i1, i2);
+            record_deviation(std::max({fabs(e.dx1 - v.dx1), fabs(e.dy1 - v.dy1), fabs(e.dx2 - v.dx2), fabs(e.dy2 - v.dy2)}));
+        }
+
+        p.dx[i1] = e.dx1;
+        p.dy[i1] = e.dy1;
+        p.dx[i2] = e.dx2;
+        p.dy[i2] = e.dy2;
+
+        static_collision(i1, i2, false);
+    }
 }
 
-void Simulation::subject_collision(Subject& s1, Subject& s2 ,const int& _counterIn)
+//
+// Infects both subjects of an overlapping pair when one of them is infected
+//
+void Simulation::transmit(std::size_t i1, std::size_t i2, int counter, std::vector<std::size_t>* deferred_infections)
 {
-    double dist = distance(s1, s2);
+    Population& p = _subjects;
+
+    // With an infection radius the contact pass passes on infections instead
+    if(_infection_radius > 0)
+    {
+        return;
+    }
 
-    if(dist < s1.radius() + s2.radius())
+    // can immuned subject infect other subject?
+    if(deferred_infections != nullptr && (p.infected(i1) || p.infected(i2)))
     {
-        // can immuned subject infect other subject?
-        if(s1.infected() || s2.infected())
+        deferred_infections->push_back(i1);
+        deferred_infections->push_back(i2);
+    }
+    else if(p.infected(i1) || p.infected(i2))
+    {
+        bool infected1 = p.infected(i1), infected2 = p.infected(i2);
+
+        //
+        // B.3. Don't reinfect if immuned
+        //
+        if(!p.immune(i1))
         {
-            //
-            // B.3. Don't reinfect if immuned
-            //
-            if(!s1.isImmunityOn())
+          p.infect(i1);
+          //
+          // B.3. start counting time until immunity starts for subject i1
+          //
+          p.start_infection2immunity_period(i1, counter);
+        }
+        if(!p.immune(i2))
+        {
+          p.infect(i2);
+          // B.3. start counting time until immunity starts for subject i2
+          p.start_infection2immunity_period(i2, counter);
+        }
+
+        if(p.event_log != nullptr)
+        {
+            if(!infected1 && p.infected(i1))
             {
-              s1.infect();
-              //
-              // B.3. start counting time until immunity starts for s1 subject instance
-              //
-              s1.StartInfection2immunityPeriodOn(_counterIn);
+                p.event_log->push_back({counter, EVENT_INFECTION, (std::uint32_t)i1, (std::uint32_t)i2});
             }
-            if(!s2.isImmunityOn())
+            if(!infected2 && p.infected(i2))
             {
-              s2.infect();
-              // B.3. start counting time until immunity starts for s2 subject instance
-              s2.StartInfection2immunityPeriodOn(_counterIn);
+                p.event_log->push_back({counter, EVENT_INFECTION, (std::uint32_t)i2, (std::uint32_t)i1});
             }
-        }        
+        }
+    }
+}
 
-        double theta1 = s1.angle();
-        double theta2 = s2.angle();
-        double phi = atan2(s1.x() - s2.x(), s1.y() - s2.y());
+//
+// Pushes the smaller subject out of the bigger one. In an emergency (still overlapping after the first
+// push) the roles are swapped. With equal radii both roles fall on i2.
+//
+void Simulation::static_collision(std::size_t i1, std::size_t i2, bool emergency)
+{
+    Population& p = _subjects;
+    double overlap = p.radius[i1] + p.radius[i2] - distance(p, i1, i2);
+    std::size_t smallerObject = p.radius[i1] < p.radius[i2] ? i1 : i2;
+    std::size_t biggerObject = p.radius[i1] > p.radius[i2] ? i1 : i2;
 
-        double dx1F = ((2.0*cos(theta2 - phi)) / 2) * cos(phi) + sin(theta1-phi) * cos(phi+M_PI/2.0);
-        double dy1F = ((2.0*cos(theta2 - phi)) / 2) * sin(phi) + sin(theta1-phi) * sin(phi+M_PI/2.0);
-        
-        double dx2F = ((2.0*cos(theta1 - phi)) / 2) * cos(phi) + sin(theta2-phi) * cos(phi+M_PI/2.0);
-        double dy2F = ((2.0*cos(theta1 - phi)) / 2) * sin(phi) + sin(theta2-phi) * sin(phi+M_PI/2.0);
+    if(emergency)
+    {
+        std::swap(smallerObject, biggerObject);
+    }
 
-        s1.set_dx(dx1F);                
-        s1.set_dy(dy1F);                
-        s2.set_dx(dx2F);                
-        s2.set_dy(dy2F);
+    // The smaller subject is pushed away from the bigger one, along the line through their centres. With equal radii
+    // both are the same subject and the direction is that of the zero vector.
+    double ux, uy;
+    if(_collision_response == CollisionResponse::Vector)
+    {
+        normalise(p.x[biggerObject] - p.x[smallerObject], p.y[biggerObject] - p.y[smallerObject], ux, uy);
+    }
+    else
+    {
+        double theta = atan2((p.y[biggerObject] - p.y[smallerObject]), (p.x[biggerObject] - p.x[smallerObject]));
+        ux = cos(theta);
+        uy = sin(theta);
+    }
+    if(_collision_response == CollisionResponse::Compare)
+    {
+        double vx, vy;
+        normalise(p.x[biggerObject] - p.x[smallerObject], p.y[biggerObject] - p.y[smallerObject], vx, vy);
+        record_deviation(std::max(fabs(ux - vx), fabs(uy - vy)));
+    }
+    p.set_x(smallerObject, p.x[smallerObject] - overlap * ux);
+    p.set_y(smallerObject, p.y[smallerObject] - overlap * uy);
 
-        static_collision(s1, s2, false);
+    if (distance(p, i1, i2) < p.radius[i1] + p.radius[i2]) {
+        if (!emergency)
+        {
+            static_collision(i1, i2, true);
+        }
     }
 }
 
-void Simulation::static_collision(Subject& s1, Subject& s2, bool emergency)
+//
+// Sorts the subjects into moving and sleeping ones and puts the sleeping ones in their own grid. Also
+// finds the sleeping subjects that overlap, in the order brute_force_collisions visits them. Only done
+// when a subject was added or a movement strategy changed since the last time.
+//
+void Simulation::update_partition()
 {
-    double overlap = s1.radius() + s2.radius() - distance(s1, s2);
-    Subject& smallerObject = s1.radius() < s2.radius() ? s1 : s2;
-    Subject& biggerObject = s1.radius() > s2.radius() ? s1 : s2;
+    const Population& p = _subjects;
+    if(p.standstill_epoch() == _partition_epoch)
+    {
+        return;
+    }
+    _partition_epoch = p.standstill_epoch();
 
-    if(emergency)
+    int max_radius = 1;
+    for(int r : p.radius)
     {
-        Subject& temp = smallerObject;
-        smallerObject = biggerObject;
-        biggerObject = temp;
+        max_radius = std::max(max_radius, r);
     }
+    _cell_size = 2.0 * max_radius;
 
-    double theta = atan2((biggerObject.y() - smallerObject.y()), (biggerObject.x() - smallerObject.x()));
-    smallerObject.set_x(smallerObject.x() - overlap * cos(theta));
-    smallerObject.set_y(smallerObject.y() - overlap * sin(theta));
+    _moving.clear();
+    _sleeping.clear();
+    _custom.clear();
+    for(std::size_t i = 0; i < p.size(); i++)
+    {
+        (p.standstill[i] ? _sleeping : _moving).push_back(i);
+        if(p.movement[i] == MOVEMENT_CUSTOM)
+        {
+            _custom.push_back(i);
+        }
+    }
 
-    if (distance(s1, s2) < s1.radius() + s2.radius()) {
-        if (!emergency)
+    _sleeping_grid.build(p.size(), _sleeping, p.x.data(), p.y.data(), _cell_size, _sim_width, _sim_height);
+
+    _sleeping_pairs.clear();
+    for(std::size_t s = _sleeping.size(); s-- > 0;)
+    {
+        std::size_t i = _sleeping[s];
+        _neighbours.clear();
+        _sleeping_grid.lower_neighbours(i, _neighbours);
+        _overlaps.clear();
+        find_overlaps(p, p.x[i], p.y[i], p.radius[i], _neighbours.data(), _neighbours.size(), _overlaps);
+        for(std::size_t k : _overlaps)
         {
-            static_collision(s1, s2, true);
+            std::size_t j = _neighbours[k];
+            if(distance(p, i, j) < p.radius[i] + p.radius[j])
+            {
+                _sleeping_pairs.emplace_back(i, j);
+            }
         }
     }
 }
 
-}
\ No newline at end of file
+}
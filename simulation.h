@@ -16,15 +16,67 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <memory>
+#include <utility>
+#include <functional>
+#include <string>
 #include "subject.h"
+#include "population.h"
 #include "canvas.h"
 #include "statistics_handler.h"
+#include "spatial_grid.h"
+#include "thread_pool.h"
+#include "rng.h"
+#include "recorder.h"
+#include "state_publisher.h"
 
 namespace corsim
 {
 
+/**
+ * The way candidate pairs for subject collisions are found. BruteForce tests every subject against every
+ * other subject and is kept to check that UniformGrid, which only tests subjects in neighbouring grid
+ * cells, gives the same results.
+ */
+enum class BroadPhase
+{
+    BruteForce,
+    UniformGrid
+};
+
+/**
+ * The math used to resolve a collision between two subjects. Both give the same exchange of directions and
+ * push-out, Trigonometric with the angles of the directions and the contact, Vector with the unit contact
+ * normal and dot products only. Their results differ in rounding, so a seed only reproduces a run with the
+ * same response. Compare uses Trigonometric and keeps track of how far Vector is off, see
+ * collision_response_deviation.
+ */
+enum class CollisionResponse
+{
+    Trigonometric,
+    Vector,
+    Compare
+};
+
+/**
+ * Controls how simulation ticks, rendering and statistics are spread over time. Every frame runs
+ * ticks_per_frame ticks and is then drawn. With ticks_per_frame 0 a frame runs as many ticks as fit in
+ * frame_interval milliseconds, so the simulation runs uncapped while still drawing a frame now and then.
+ * The browser build waits until frame_interval has passed before starting the next frame, native
+ * builds never wait. Runs that nobody looks at, like those of an ensemble, turn draw off to skip drawing
+ * and publishing the frames.
+ */
+struct Schedule
+{
+    int ticks_per_frame = 1;
+    int frame_interval = 1000/30; // milliseconds
+    int stats_interval = 30;      // ticks between updates of the statistics handler
+    bool draw = true;
+};
+
 /**
  * The simulation class controls the simulation. It has a list of all the subjects that being simulated and
  * can be run. Its constructor takes a canvas to draw the simulation on and a statistics handler to give an
@@ -35,23 +87,141 @@ class Simulation
      public:
         Simulation(int width, int height, std::unique_ptr<Canvas> canvas, std::unique_ptr<StatisticsHandler> sh);
         void add_subject(Subject&& s);
-        void run(); //This method starts the simulation but locks execution because theading is not supported in WASM
+        //Removes all subjects and starts counting ticks from 0 again. Settings and allocated memory are kept, so a
+        //simulation can be reused for a new run.
+        void clear();
+        //Adds a subject straight into the population of the simulation and returns its index, use subject() to set it up.
+        //disease is an index returned by add_disease.
+        std::size_t add_subject(double x, double y, int radius, bool infected, std::uint16_t disease);
+        std::uint16_t add_disease(const DiseaseParameters& parameters);
+        //This method starts the simulation and runs tick_count ticks, or forever when tick_count is negative.
+        //It locks execution because theading is not supported in WASM. Native builds do not sleep between frames.
+        //Browser builds can only sleep when built with ASYNCIFY (and CORSIM_ASYNCIFY defined), see run_in_main_loop,
+        //or when running in a worker (CORSIM_WORKER defined).
+        void run(int tick_count = -1);
+        //Version of run for the browser that does not block it: every animation frame of the browser runs a frame of
+        //the simulation once the frame interval has passed, until tick_count ticks have run. In the browser it never
+        //returns, the code after it does not run and the stack of the caller is kept so the simulation stays alive.
+        //Native builds have no main loop, there it is run.
+        void run_in_main_loop(int tick_count = -1);
+        //Runs the ticks of a single frame, but no more than max_ticks when it is not negative, and draws the
+        //frame. Returns the number of ticks that were run.
+        int frame(int max_ticks = -1);
+        //Negative ticks per frame and frame intervals are taken as 0, a statistics interval below 1 as 1
+        void set_schedule(const Schedule& schedule);
+        int counter() const; //Number of ticks simulated so far
+        //Number of B.3. immunity transitions still to come. Without infected subjects and pending transitions
+        //nothing changes anymore.
+        std::size_t pending_transitions() const;
+        //Number of subjects in every compartment, kept up to date on every change so it is cheap to ask for
+        const Compartments& compartments() const;
+        void set_broad_phase(BroadPhase broad_phase);
+        void set_collision_response(CollisionResponse response);
+        //Largest difference in a velocity or push-out direction component between the two responses so far, in
+        //CollisionResponse::Compare mode
+        double collision_response_deviation() const;
+        //Distance between the centres of an infected subject and the subjects it infects. 0, the default, infects the
+        //subjects that collide. Above 0 infection is left out of the collisions and happens in a contact pass of its
+        //own after them, which only looks around the infected subjects.
+        void set_infection_radius(double radius);
+        //Chance per tick that a contact of the contact pass infects. A subject in contact with k infected subjects is
+        //infected with chance 1 - (1 - probability)^k. Only used with an infection radius, 1 by default.
+        void set_transmission_probability(double probability);
+        //Runs the tick on thread_count threads by splitting the area into strips, 0 (the default) keeps the serial
+        //tick. Results of any thread count of 1 or more only depend on the seed and agree with each other, but differ
+        //from those of the serial tick, which visits the pairs in another order and infects right away. Needs the
+        //UniformGrid broad phase.
+        void set_thread_count(unsigned thread_count);
+        //Seed of all random decisions in the simulation, including setting up the population
+        void set_seed(std::uint64_t seed);
+        const CounterRng& rng() const;
+        //Saves the population, tick counter and seed, everything needed to continue exactly as this simulation would
+        //have (see checkpoint.h). Returns false when a subject has a custom movement strategy or writing fails.
+        bool save_checkpoint(const std::string& path) const;
+        bool save_checkpoint(std::vector<char>& out) const;
+        //Continues from a checkpoint of a simulation with the same width and height, replacing all subjects. The
+        //second version reads a checkpoint in memory, like a mapped file or one saved to memory before.
+        bool load_checkpoint(const std::string& path);
+        bool load_checkpoint(const char* data, std::size_t size);
+        //Records subject positions, states and disease events every `interval` ticks, nullptr stops recording
+        void set_recorder(std::unique_ptr<Recorder> recorder, int interval = 1);
+        //Writes what is left of the recording and stops recording. Returns false when not all of it could be written.
+        bool finish_recording();
+        //Publishes the subjects after every drawn frame for a page that draws them itself, nullptr stops publishing
+        void set_publisher(std::unique_ptr<StatePublisher> publisher);
+        std::size_t subject_count() const;
+        Subject subject(std::size_t index); //Handle to a subject that has been added to the simulation
+        const Population& population() const;
     private:
-        void wall_collision(Subject& s);
+        void wall_collision(std::size_t i);
         //
         // B.3. propogate counter tick count to allow time related behaviour on immunity
         //
-        void subject_collision(Subject& s1, Subject& s2 , const int& _counterIn);
-        void static_collision(Subject& s1, Subject& s2, bool emergency);
+        //When deferred_infections is given, subjects to infect are appended to it instead of infected right away
+        void subject_collision(std::size_t i1, std::size_t i2, const int& _counterIn, std::vector<std::size_t>* deferred_infections = nullptr);
+        void transmit(std::size_t i1, std::size_t i2, int counter, std::vector<std::size_t>* deferred_infections);
+        void static_collision(std::size_t i1, std::size_t i2, bool emergency);
+        void record_deviation(double difference);
+        void brute_force_collisions(int counter);
+        void grid_collisions(int counter);
+        void strip_collisions(int counter);
+        void sleeping_contacts(int counter, std::vector<std::size_t>* deferred_infections);
+        void update_partition();
+        void contact_pass(int counter);
+        void collision_candidates(std::size_t i, int cell, std::vector<std::size_t>& out) const;
+        void for_each_range(const std::function<void(std::size_t, std::size_t, std::size_t)>& f);
         void tick();
         void draw_to_canvas();
+        static void main_loop_frame(void* simulation);
 
         std::unique_ptr<Canvas> _canvas;
-        std::vector<Subject> _subjects;
+        Population _subjects;
         std::unique_ptr<StatisticsHandler> _sh;
         bool running = false;
+        int _main_loop_remaining = -1;                              // ticks left to run from the main loop
+        std::chrono::steady_clock::time_point _main_loop_next_frame; // earliest start of the next frame
+        int _counter = 0;
+        CounterRng _rng;
         int tick_speed = 1000/30;
+        Schedule _schedule;
         int _sim_width = 800, _sim_height = 500;
+        BroadPhase _broad_phase = BroadPhase::UniformGrid;
+        CollisionResponse _collision_response = CollisionResponse::Trigonometric;
+        std::atomic<double> _collision_deviation{0}; // collisions are resolved on several threads in a parallel tick
+        SpatialGrid _grid;
+        std::vector<std::size_t> _neighbours;
+        std::vector<std::size_t> _overlaps; // positions in _neighbours that the narrow phase let through
+
+        // Sleeping subjects, whose A. strategy stands still, never move. They are kept in their own grid
+        // that is only rebuilt when a strategy changes, see update_partition
+        std::uint64_t _partition_epoch = ~(std::uint64_t)0;
+        double _cell_size = 2;
+        std::vector<std::size_t> _moving, _sleeping;
+        std::vector<std::size_t> _custom; // subjects with a custom movement strategy
+        SpatialGrid _sleeping_grid;
+        std::vector<std::pair<std::size_t, std::size_t>> _sleeping_pairs; // overlapping sleeping subjects
+        std::vector<std::size_t> _sleeping_infections;
+
+        // Contact pass, see contact_pass
+        double _infection_radius = 0;
+        double _transmission_probability = 1;
+        std::vector<std::size_t> _frontier; // infected subjects at the start of the pass
+        std::vector<std::vector<std::size_t>> _contact_neighbours;
+        std::vector<std::vector<std::pair<std::size_t, std::size_t>>> _contacts; // (subject, infected source) per range
+        std::vector<std::pair<std::size_t, std::size_t>> _contact_pairs;
+
+        std::unique_ptr<Recorder> _recorder;
+        int _record_interval = 1;
+        std::vector<SubjectEvent> _events; // since the last recorded tick
+
+        std::unique_ptr<StatePublisher> _publisher;
+
+        // Parallel tick, see strip_collisions
+        static const int STRIP_COLUMNS = 8; // width of a strip in grid cells
+        std::unique_ptr<ThreadPool> _pool;
+        std::vector<int> _strip_start, _strip_cursor;
+        std::vector<std::size_t> _strip_items;
+        std::vector<std::vector<std::size_t>> _strip_neighbours, _strip_infections;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "spatial_grid.h"
+#include <algorithm>
+#include <math.h>
+
+namespace corsim
+{
+
+void SpatialGrid::build(std::size_t count, const double* xs, const double* ys, double cell_size, double width, double height)
+{
+    reset(count, cell_size, width, height);
+
+    for(std::size_t i = 0; i < count; i++)
+    {
+        link((int)i, cell_of(xs[i], ys[i]));
+    }
+}
+
+void SpatialGrid::build(std::size_t count, const std::vector<std::size_t>& items, const double* xs, const double* ys,
+    double cell_size, double width, double height)
+{
+    reset(count, cell_size, width, height);
+    _item_cell.assign(count, -1);
+
+    for(std::size_t i : items)
+    {
+        link((int)i, cell_of(xs[i], ys[i]));
+    }
+}
+
+void SpatialGrid::reset(std::size_t count, double cell_size, double width, double height)
+{
+    _cell_size = cell_size > 0 ? cell_size : 1;
+    int columns = std::max(1, (int)ceil(width / _cell_size));
+    int rows = std::max(1, (int)ceil(height / _cell_size));
+
+    if(columns == _columns && rows == _rows)
+    {
+        // Most cells are empty when only a few items are in the grid, only empty the cells that were used
+        for(int cell : _item_cell)
+        {
+            if(cell != -1)
+            {
+                _head[cell] = -1;
+            }
+        }
+    }
+    else
+    {
+        _columns = columns;
+        _rows = rows;
+        _head.assign(_columns * _rows, -1);
+    }
+    _next.resize(count);
+    _prev.resize(count);
+    _item_cell.resize(count);
+}
+
+bool SpatialGrid::move(std::size_t index, double x, double y)
+{
+    int cell = cell_of(x, y);
+    if(cell == _item_cell[index])
+    {
+        return false;
+    }
+
+    unlink((int)index);
+    link((int)index, cell);
+    return true;
+}
+
+int SpatialGrid::cell_of(double x, double y) const
+{
+    // Subjects can be pushed slightly outside of the area by a collision, clamp them to the border cells
+    int cx = std::min(std::max((int)floor(x / _cell_size), 0), _columns - 1);
+    int cy = std::min(std::max((int)floor(y / _cell_size), 0), _rows - 1);
+    return cy * _columns + cx;
+}
+
+void SpatialGrid::link(int item, int cell)
+{
+    _item_cell[item] = cell;
+    _prev[item] = -1;
+    _next[item] = _head[cell];
+    if(_head[cell] != -1)
+    {
+        _prev[_head[cell]] = item;
+    }
+    _head[cell] = item;
+}
+
+void SpatialGrid::unlink(int item)
+{
+    if(_prev[item] != -1)
+    {
+        _next[_prev[item]] = _next[item];
+    }
+    else
+    {
+        _head[_item_cell[item]] = _next[item];
+    }
+
+    if(_next[item] != -1)
+    {
+        _prev[_next[item]] = _prev[item];
+    }
+}
+
+void SpatialGrid::lower_neighbours(std::size_t index, double x, double y, std::vector<std::size_t>& out) const
+{
+    cell_neighbours(cell_of(x, y), index, out);
+}
+
+void SpatialGrid::lower_neighbours(std::size_t index, std::vector<std::size_t>& out) const
+{
+    cell_neighbours(_item_cell[index], index, out);
+}
+
+void SpatialGrid::neighbours(double x, double y, std::vector<std::size_t>& out) const
+{
+    cell_neighbours(cell_of(x, y), _next.size(), out);
+}
+
+void SpatialGrid::neighbours(double x, double y, double distance, std::vector<std::size_t>& out) const
+{
+    std::size_t first = out.size();
+    int low = cell_of(x - distance, y - distance);
+    int high = cell_of(x + distance, y + distance);
+
+    for(int cy = low / _columns; cy <= high / _columns; cy++)
+    {
+        for(int cx = low % _columns; cx <= high % _columns; cx++)
+        {
+            for(int item = _head[cy * _columns + cx]; item != -1; item = _next[item])
+            {
+                out.push_back(item);
+            }
+        }
+    }
+
+    std::sort(out.begin() + first, out.end());
+}
+
+void SpatialGrid::cell_neighbours(int cell, std::vector<std::size_t>& out) const
+{
+    cell_neighbours(cell, _next.size(), out);
+}
+
+void SpatialGrid::cell_neighbours(int cell, std::size_t index, std::vector<std::size_t>& out) const
+{
+    std::size_t first = out.size();
+    int cx = cell % _columns;
+    int cy = cell / _columns;
+
+    for(int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, _rows - 1); ny++)
+    {
+        for(int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, _columns - 1); nx++)
+        {
+            for(int item = _head[ny * _columns + nx]; item != -1; item = _next[item])
+            {
+                if((std::size_t)item < index)
+                {
+                    out.push_back(item);
+                }
+            }
+        }
+    }
+
+    std::sort(out.begin() + first, out.end());
+}
+
+}
@@ -0,0 +1,100 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace corsim
+{
+
+/**
+ * A uniform grid over the simulated area used as a broad phase for collision
+ * checks. Items are bucketed by the cell their position falls in, so only items
+ * in the same or a neighbouring cell have to be tested against each other. With
+ * a cell size of at least twice the largest radius, every overlapping pair is
+ * guaranteed to be found in the 3x3 block of cells around an item.
+ *
+ * Collisions push subjects around, so items can be moved to another cell after the
+ * grid was built. Every cell is a doubly linked list threaded through arrays to
+ * make that cheap.
+ *
+ * A grid can also hold just a subset of the items, the others are left out of every cell.
+ */
+class SpatialGrid
+{
+    public:
+        void build(std::size_t count, const double* xs, const double* ys, double cell_size, double width, double height);
+
+        //
+        // Builds the grid with only `items` in it, indices into xs and ys of `count` items
+        //
+        void build(std::size_t count, const std::vector<std::size_t>& items, const double* xs, const double* ys,
+            double cell_size, double width, double height);
+
+        //
+        // Moves item `index` to the cell of its new position, returns whether the cell changed
+        //
+        bool move(std::size_t index, double x, double y);
+
+        //
+        // Appends all items with an index lower than `index` that are in the same or a
+        // neighbouring cell of position (x, y) to `out`, in ascending order.
+        //
+        void lower_neighbours(std::size_t index, double x, double y, std::vector<std::size_t>& out) const;
+
+        //
+        // Same as above, but around the cell item `index` was put in when the grid was built or last moved
+        //
+        void lower_neighbours(std::size_t index, std::vector<std::size_t>& out) const;
+
+        //
+        // Appends all items in the same or a neighbouring cell of position (x, y) to `out`, in ascending order
+        //
+        void neighbours(double x, double y, std::vector<std::size_t>& out) const;
+
+        //
+        // Same as above, but around `cell`. Grids with the same cell size and area share their cell numbers.
+        //
+        void cell_neighbours(int cell, std::vector<std::size_t>& out) const;
+
+        //
+        // Appends all items in the cells that overlap the square of 2 * `distance` wide around position (x, y) to
+        // `out`, in ascending order. These include every item closer than `distance` to (x, y).
+        //
+        void neighbours(double x, double y, double distance, std::vector<std::size_t>& out) const;
+
+        double cell_size() const { return _cell_size; }
+        int columns() const { return _columns; }
+        int column_of(std::size_t index) const { return _item_cell[index] % _columns; }
+        int cell_of_item(std::size_t index) const { return _item_cell[index]; }
+
+    private:
+        int cell_of(double x, double y) const;
+        void reset(std::size_t count, double cell_size, double width, double height);
+        void cell_neighbours(int cell, std::size_t index, std::vector<std::size_t>& out) const;
+        void link(int item, int cell);
+        void unlink(int item);
+
+        double _cell_size = 1;
+        int _columns = 0, _rows = 0;
+        std::vector<int> _head;       // first item of every cell, -1 when empty
+        std::vector<int> _next, _prev; // neighbouring items in the same cell, -1 at the ends
+        std::vector<int> _item_cell;  // cell of every item, -1 when it is not in the grid
+};
+
+}
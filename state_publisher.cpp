@@ -0,0 +1,95 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "state_publisher.h"
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+namespace corsim
+{
+
+namespace
+{
+    // The page has no other way to find the header than asking for it, there is only one publisher at a time
+    std::atomic<void*> shared_state{nullptr};
+}
+
+StatePublisher::StatePublisher(int width, int height)
+{
+    static_assert(sizeof(std::atomic<std::int32_t>) == sizeof(std::int32_t), "the page reads the header as int32");
+
+    _header.width = width;
+    _header.height = height;
+    for(Buffer& buffer : _header.buffers)
+    {
+        buffer = Buffer{0, 0, 0};
+    }
+    shared_state = &_header;
+}
+
+StatePublisher::~StatePublisher()
+{
+    void* expected = &_header;
+    shared_state.compare_exchange_strong(expected, nullptr);
+}
+
+bool StatePublisher::publish(int tick, const Population& population)
+{
+    int front = _header.front.load();
+    int back = front == 0 ? 1 : 0;
+
+    // The page read the front before it became the previous front and has not finished drawing it yet
+    if(_header.reading.load() == back)
+    {
+        return false;
+    }
+
+    std::size_t n = population.size();
+    std::vector<float>& data = _data[back];
+    data.resize(n * VALUES_PER_SUBJECT);
+
+    float* out = data.data();
+    for(std::size_t i = 0; i < n; i++)
+    {
+        out[0] = (float)population.x[i];
+        out[1] = (float)population.y[i];
+        out[2] = (float)population.radius[i];
+        out[3] = (float)(population.state[i] | (population.standstill[i] ? PUBLISHED_STAND_STILL : 0));
+        out += VALUES_PER_SUBJECT;
+    }
+
+    Buffer& buffer = _header.buffers[back];
+    buffer.tick = tick;
+    buffer.count = (std::int32_t)n;
+    buffer.data = (std::int32_t)(std::intptr_t)data.data();
+
+    // Sequentially consistent, everything written above is visible to the page once it sees the new front
+    _header.front.store(back);
+    return true;
+}
+
+}
+
+#ifdef __EMSCRIPTEN__
+//
+// Address of the header of the current StatePublisher, 0 when there is none
+//
+extern "C" EMSCRIPTEN_KEEPALIVE std::intptr_t corsim_shared_state()
+{
+    return (std::intptr_t)corsim::shared_state.load();
+}
+#endif
@@ -0,0 +1,86 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "population.h"
+
+namespace corsim
+{
+
+/**
+ * Publishes the positions and states of all subjects for a page that draws them on its own thread, used by
+ * the worker build where the simulation runs in a Web Worker (see CORSIM_WORKER in main.cpp). Memory of a
+ * pthreads build is a SharedArrayBuffer, so the page reads the buffers straight from the heap.
+ *
+ * There are two buffers. The simulation writes a frame into the one the page is not told about and then
+ * makes it the front buffer. The page marks the front buffer as the one it is reading before drawing it, and
+ * checks that it is still the front buffer afterwards. The simulation skips a frame rather than write into a
+ * buffer the page is reading, so neither side ever waits for the other.
+ *
+ * Layout of the header, int32 values, see corsim_shared_state():
+ *
+ *   0  front     buffer to draw, -1 before the first frame (Atomics)
+ *   1  reading   buffer the page is drawing, -1 when it is not drawing (Atomics)
+ *   2  width     of the simulated area
+ *   3  height
+ *   then for both buffers: tick, subject count, address of the data
+ *
+ * The data of a buffer holds float32 x, y, radius and flags for every subject. The flags are the
+ * SubjectStateFlags, plus PUBLISHED_STAND_STILL when the subject stands still.
+ */
+class StatePublisher
+{
+    public:
+        static const int PUBLISHED_STAND_STILL = 4;
+        static const int VALUES_PER_SUBJECT = 4;
+
+        StatePublisher(int width, int height);
+        ~StatePublisher();
+        StatePublisher(const StatePublisher&) = delete;
+        StatePublisher& operator=(const StatePublisher&) = delete;
+
+        //
+        // Publishes the subjects of tick `tick`, returns false when the frame was skipped because the page is
+        // still drawing the buffer it would go in
+        //
+        bool publish(int tick, const Population& population);
+
+    private:
+        struct Buffer
+        {
+            std::int32_t tick;
+            std::int32_t count;
+            std::int32_t data; // address in the heap, 32 bit in WASM
+        };
+
+        struct Header
+        {
+            std::atomic<std::int32_t> front{-1};
+            std::atomic<std::int32_t> reading{-1};
+            std::int32_t width;
+            std::int32_t height;
+            Buffer buffers[2];
+        };
+
+        Header _header;
+        std::vector<float> _data[2];
+};
+
+}
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include "compartments.h"
+
 namespace corsim
 {
 
@@ -28,6 +30,20 @@ class StatisticsHandler
     public:
     virtual ~StatisticsHandler(){};
     virtual void communicate_number_infected(int time, int infected) = 0;
+
+    //
+    // Called instead of communicate_number_infected with the size of every compartment. Handlers that
+    // only show the number of infected do not have to override it.
+    //
+    virtual void communicate_compartments(int time, const Compartments& compartments)
+    {
+        communicate_number_infected(time, (int)compartments.infected);
+    }
+
+    //
+    // Called when the simulation finished a run, handlers that hold statistics back pass them on
+    //
+    virtual void flush(){};
 };
 
 
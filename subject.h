@@ -16,12 +16,20 @@
 
 #pragma once 
 
+#include <cstddef>
+#include <memory>
+#include "population.h"
+
 namespace corsim
 {
     
 /**
  * A subject is an entity within the simulation. It is modeled as a
  * circle in 2D and can be infected.
+ *
+ * The data of a subject lives in a Population, a Subject is a handle to one of its
+ * entries. A subject constructed on its own owns a population with just itself in it,
+ * so it can be set up before it is added to a simulation.
  */
 class Subject
 {
@@ -36,15 +44,29 @@ class Subject
         //
         Subject(int x, int y, int radius, bool infected, std::shared_ptr<const int> infection2immunityDuration , std::shared_ptr<const int> immunityDuration , std::shared_ptr<const int> tick_speed);
 
+        //
+        // Same as above with the three durations in one DiseaseParameters
+        //
+        Subject(int x, int y, int radius, bool infected, const DiseaseParameters& disease);
+
+        //
+        // Handle to subject `index` of `population`
+        //
+        Subject(Population& population, std::size_t index);
+
         //
         // Subject class copy constructor 
+        // a copy of a handle refers to the same subject, a copy of a subject that owns its data is a deep copy
         //
         Subject(const Subject& other);
+        Subject(Subject&& other) = default;
 
         //
         // Subject class assignment operator 
+        // same semantics as the copy constructor
         //
         Subject& operator=(Subject const &rhs);
+        Subject& operator=(Subject&& rhs) = default;
 
         //
         // Fields getters and setters 
@@ -98,6 +120,18 @@ class Subject
         // create strategy instance true -> stand still / false Move
         void SelectMovementStrategy(const bool& standOrMove);
 
+        //
+        // A. bind a concrete strategy algorithm to this subject, see Population::set_movement_strategy
+        //
+        void set_movement(MovementKind kind);
+        void set_movement_strategy(std::shared_ptr< MovementStrategyInterface > strategy);
+        void set_movement_strategy(std::shared_ptr< MovementStrategyInterface* > strategy);
+
+        //
+        // B.3. switch to entry `disease` of the disease parameter table (see Simulation::add_disease) for the next
+        // infection, a period that already started keeps its end
+        //
+        void set_disease(std::uint16_t disease);
 
         // 
         // member function isStandStill
@@ -105,58 +139,13 @@ class Subject
         //   
         bool isStandStill();
 
+        Population& population();
+        std::size_t index();
+
     private:
-        double _x = 0,_y = 0, _dx = 0, _dy = 0;
-        bool _infected = false;
-        int _radius = 0;
-
-        //
-        // B.3 immunity nested class / struct  decleration
-        //
-        struct Immunity
-        {
-            // Immunity struct constructor 
-            // allowes setting 3 parameters
-            // infection2immunityDuration = Time period from the moment a subject was infected until he gets immuned.
-            // immunityDuration = Time period from the moment a subject was immuned until he lost his immunity (can be infected again).
-            // tick_speed = speed of simulation. Remark : tick_speed must be same value as set in simulation class
-            //              it is duplicate parameter to avoid changing simulation class (minimizing changes for the rest of the development team). 
-            Immunity( std::shared_ptr<const int> infection2immunityDuration , std::shared_ptr<const int> immunityDuration, std::shared_ptr<const int> tick_speed);
-            // Immunity struct copy constructor 
-            Immunity(const Immunity& other);
-            // Immunity assignment operator  
-            Immunity& operator=(Immunity const &rhs);
-            // immunity flag (true = immuned)
-            bool _immuned = false;
-            // immunity start time window 
-            int _timestampStart = 0;
-            // immunity End when immunity will expire
-            int _timestampEnd = 0;
-            // moment the subject get infected start counting until Immuned 
-            int _timestampInfection2immunityStart = 0;
-            // passed illness time counting until Immuned
-            int _timestampInfection2immunityEnd = 0;
-            // Time period from the moment a subject was infected until he gets immuned.
-            std::shared_ptr<const int> _infection2immunityDuration;
-            // Time period from the moment a subject was immuned until he lost his immunity (can be infected again).
-            std::shared_ptr<const int> _immunityDuration;
-            // speed of simulation. Remark : tick_speed must be same value as set in simulation class
-            //              it is duplicate parameter to avoid changing simulation class (minimizing changes for the rest of the development team). 
-            std::shared_ptr<const int> _tick_speed; // milliseconds per tick
-        };
-
-        //
-        // B.3 The actual instance of  Immunity object
-        //
-        Immunity _immunity;
-   public:
-
-        //
-        // A. Polimorphic class interface (RAII style - auto release using shared_ptr) MovementStrategyInterface
-        // selecting in real time one algorithm out of strategy RegularMovementStrategy or LockdownMovementStrategy
-        // concrete algorithms implementations. 
-        //
-        std::shared_ptr< MovementStrategyInterface* > _movementStrategy = nullptr; 
+        std::unique_ptr<Population> _owned; // only set when this subject is not part of a simulation
+        Population* _population = nullptr;
+        std::size_t _index = 0;
 };
 
 };
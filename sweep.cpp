@@ -0,0 +1,293 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "sweep.h"
+#include "null_canvas.h"
+#include "null_statistics_handler.h"
+#include "simulation.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <math.h>
+
+namespace corsim
+{
+
+namespace
+{
+
+const char* PARAMETER_NAMES[] = {"subject_count", "radius", "lockdown_fraction", "infection2immunity_ticks",
+    "immunity_ticks"};
+
+void set_parameter(Scenario& scenario, SweepParameter parameter, double value)
+{
+    switch(parameter)
+    {
+        case SWEEP_SUBJECT_COUNT: scenario.subject_count = (int)round(value); break;
+        case SWEEP_RADIUS: scenario.radius = (int)round(value); break;
+        case SWEEP_LOCKDOWN_FRACTION: scenario.lockdown_fraction = value; break;
+        case SWEEP_INFECTION2IMMUNITY_TICKS: scenario.infection2immunity_ticks = (int)round(value); break;
+        case SWEEP_IMMUNITY_TICKS: scenario.immunity_ticks = (int)round(value); break;
+    }
+}
+
+bool same_population(const Scenario& a, const Scenario& b)
+{
+    return a.subject_count == b.subject_count && a.radius == b.radius;
+}
+
+std::unique_ptr<Simulation> make_simulation(const Scenario& scenario, int check_interval, std::uint64_t seed)
+{
+    auto s = std::make_unique<Simulation>(scenario.width, scenario.height, std::make_unique<NullCanvas>(),
+        std::make_unique<NullStatisticsHandler>());
+    Schedule schedule;
+    schedule.ticks_per_frame = check_interval;
+    schedule.stats_interval = check_interval;
+    s->set_schedule(schedule);
+    s->set_seed(seed);
+    return s;
+}
+
+}
+
+const char* sweep_parameter_name(SweepParameter parameter)
+{
+    return PARAMETER_NAMES[parameter];
+}
+
+bool parse_sweep_parameter(const std::string& name, SweepParameter& parameter)
+{
+    for(int p = SWEEP_SUBJECT_COUNT; p <= SWEEP_IMMUNITY_TICKS; p++)
+    {
+        if(name == PARAMETER_NAMES[p])
+        {
+            parameter = (SweepParameter)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+Sweep::Sweep(const SweepConfig& config) : _config{config}
+{
+    _config.replicates = std::max(_config.replicates, 1);
+    _config.samples = std::max(_config.samples, 1);
+    _config.check_interval = std::max(_config.check_interval, 1);
+    _config.tick_count = std::max(_config.tick_count, 0);
+    _config.warmup_ticks = std::min(std::max(_config.warmup_ticks, 0), _config.tick_count);
+    _config.factors.erase(std::remove_if(_config.factors.begin(), _config.factors.end(),
+        [](const SweepFactor& factor) { return factor.values.empty(); }), _config.factors.end());
+
+    make_points();
+
+    for(const Scenario& point : _points)
+    {
+        std::size_t population = 0;
+        while(population < _populations.size() && !same_population(_populations[population], point))
+        {
+            population++;
+        }
+        if(population == _populations.size())
+        {
+            Scenario warmup = _config.scenario;
+            warmup.subject_count = point.subject_count;
+            warmup.radius = point.radius;
+            _populations.push_back(warmup);
+        }
+        _point_population.push_back(population);
+    }
+}
+
+void Sweep::make_points()
+{
+    if(_config.design == SweepDesign::Grid)
+    {
+        // Counts through the combinations, the last factor changes fastest
+        std::vector<std::size_t> level(_config.factors.size(), 0);
+        while(true)
+        {
+            Scenario point = _config.scenario;
+            for(std::size_t f = 0; f < _config.factors.size(); f++)
+            {
+                set_parameter(point, _config.factors[f].parameter, _config.factors[f].values[level[f]]);
+            }
+            _points.push_back(point);
+
+            std::size_t f = _config.factors.size();
+            while(f > 0 && ++level[f - 1] == _config.factors[f - 1].values.size())
+            {
+                level[--f] = 0;
+            }
+            if(f == 0)
+            {
+                break;
+            }
+        }
+        return;
+    }
+
+    // Every factor gets its own random order of the strata and a random position within each stratum. The
+    // design only depends on the base seed.
+    std::size_t n = (std::size_t)_config.samples;
+    CounterRng rng(_config.base_seed);
+    _points.assign(n, _config.scenario);
+    std::vector<std::size_t> strata(n);
+    for(std::size_t f = 0; f < _config.factors.size(); f++)
+    {
+        const SweepFactor& factor = _config.factors[f];
+        double low = *std::min_element(factor.values.begin(), factor.values.end());
+        double high = *std::max_element(factor.values.begin(), factor.values.end());
+
+        for(std::size_t i = 0; i < n; i++)
+        {
+            strata[i] = i;
+        }
+        for(std::size_t i = n - 1; i > 0; i--)
+        {
+            std::swap(strata[i], strata[(std::size_t)(rng.uniform((std::uint32_t)f, (std::uint32_t)i, 0) * (i + 1))]);
+        }
+        for(std::size_t i = 0; i < n; i++)
+        {
+            double u = (strata[i] + rng.uniform((std::uint32_t)f, (std::uint32_t)i, 1)) / n;
+            set_parameter(_points[i], factor.parameter, low + u * (high - low));
+        }
+    }
+}
+
+bool Sweep::run(std::ostream& out)
+{
+    std::size_t replicates = (std::size_t)_config.replicates;
+    ThreadPool pool(std::max(_config.thread_count, 1u));
+
+    _snapshots.assign(_config.warmup_ticks > 0 ? _populations.size() * replicates : 0, std::vector<char>());
+    _warmups.assign(_snapshots.size(), Result());
+    pool.run(_snapshots.size(), [this](std::size_t snapshot)
+    {
+        warm_up(snapshot);
+    });
+
+    _results.assign(_points.size() * replicates, Result());
+    pool.run(_results.size(), [this](std::size_t run)
+    {
+        run_one(run);
+    });
+    _snapshots.clear();
+    _warmups.clear();
+
+    write_results(out);
+    return std::none_of(_results.begin(), _results.end(), [](const Result& result) { return result.failed; });
+}
+
+void Sweep::warm_up(std::size_t snapshot)
+{
+    const Scenario& population = _populations[snapshot / _config.replicates];
+    auto s = make_simulation(population, _config.check_interval, _config.base_seed + snapshot % _config.replicates);
+    populate(*s, population);
+
+    // Runs that died out during the warm-up are over, there is nothing to continue
+    run_until(*s, _warmups[snapshot], _config.warmup_ticks);
+    if(!_warmups[snapshot].died_out && !s->save_checkpoint(_snapshots[snapshot]))
+    {
+        _warmups[snapshot].failed = true;
+    }
+}
+
+void Sweep::run_one(std::size_t run)
+{
+    std::size_t point = run / _config.replicates, replicate = run % _config.replicates;
+    const Scenario& scenario = _points[point];
+    auto s = make_simulation(scenario, _config.check_interval, _config.base_seed + replicate);
+
+    Result& result = _results[run];
+    if(_config.warmup_ticks > 0)
+    {
+        std::size_t snapshot = _point_population[point] * _config.replicates + replicate;
+        result = _warmups[snapshot];
+        if(result.died_out || result.failed)
+        {
+            return;
+        }
+        if(!s->load_checkpoint(_snapshots[snapshot].data(), _snapshots[snapshot].size()))
+        {
+            result.failed = true;
+            return;
+        }
+        apply_measures(*s, scenario);
+    }
+    else
+    {
+        populate(*s, scenario);
+    }
+
+    run_until(*s, result, _config.tick_count);
+}
+
+//
+// Runs `simulation` until tick `tick_count` or until the epidemic died out, and keeps track of the numbers of
+// infected and immune subjects in `result` every check interval
+//
+void Sweep::run_until(Simulation& simulation, Result& result, int tick_count) const
+{
+    while(true)
+    {
+        const Compartments& compartments = simulation.compartments();
+        int infected = (int)compartments.infected, immune = (int)compartments.immune;
+        if(infected > result.peak_infected)
+        {
+            result.peak_infected = infected;
+            result.peak_tick = simulation.counter();
+        }
+        result.infected = infected;
+        result.immune = immune;
+
+        if(infected == 0 && simulation.pending_transitions() == 0)
+        {
+            result.died_out = true;
+            break;
+        }
+        if(simulation.counter() >= tick_count)
+        {
+            break;
+        }
+        simulation.run(std::min(_config.check_interval, tick_count - simulation.counter()));
+    }
+    result.ticks = simulation.counter();
+}
+
+void Sweep::write_results(std::ostream& out) const
+{
+    out << "point,replicate,seed";
+    for(int p = SWEEP_SUBJECT_COUNT; p <= SWEEP_IMMUNITY_TICKS; p++)
+    {
+        out << ',' << PARAMETER_NAMES[p];
+    }
+    out << ",ticks,died_out,peak_infected,peak_tick,infected,immune,failed\n";
+
+    for(std::size_t run = 0; run < _results.size(); run++)
+    {
+        std::size_t point = run / _config.replicates, replicate = run % _config.replicates;
+        const Scenario& scenario = _points[point];
+        const Result& result = _results[run];
+
+        out << point << ',' << replicate << ',' << _config.base_seed + replicate << ','
+            << scenario.subject_count << ',' << scenario.radius << ',' << scenario.lockdown_fraction << ','
+            << scenario.infection2immunity_ticks << ',' << scenario.immunity_ticks << ','
+            << result.ticks << ',' << (result.died_out ? 1 : 0) << ',' << result.peak_infected << ','
+            << result.peak_tick << ',' << result.infected << ',' << result.immune << ',' << (result.failed ? 1 : 0) << '\n';
+    }
+    out.flush();
+}
+
+}
@@ -0,0 +1,131 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "scenario.h"
+
+namespace corsim
+{
+
+//
+// The parameters of a Scenario a sweep can vary
+//
+enum SweepParameter
+{
+    SWEEP_SUBJECT_COUNT,
+    SWEEP_RADIUS,
+    SWEEP_LOCKDOWN_FRACTION,
+    SWEEP_INFECTION2IMMUNITY_TICKS,
+    SWEEP_IMMUNITY_TICKS
+};
+
+//
+// Name of a parameter as used on the command line and in the results, the name of the Scenario field
+//
+const char* sweep_parameter_name(SweepParameter parameter);
+bool parse_sweep_parameter(const std::string& name, SweepParameter& parameter);
+
+struct SweepFactor
+{
+    SweepParameter parameter;
+    std::vector<double> values; // the levels of a grid, the lowest and highest value are the range of a Latin hypercube
+};
+
+enum class SweepDesign
+{
+    Grid,          // every combination of the values of all factors
+    LatinHypercube // `samples` points, every factor range split in `samples` strata that are each used once
+};
+
+/**
+ * The setup of a sweep: the points of the design are variations of `scenario`, each is run `replicates`
+ * times. Replicate r is seeded with base_seed + r for every point, so points are compared on the same
+ * random numbers.
+ *
+ * With warmup_ticks above 0 the lockdown fraction and immunity periods of a point only take effect after
+ * the warm-up, before that all points with the same population run `scenario`. The warm-up is then run
+ * only once per population and replicate, see apply_measures.
+ */
+struct SweepConfig
+{
+    Scenario scenario;
+    std::vector<SweepFactor> factors;
+    SweepDesign design = SweepDesign::Grid;
+    int samples = 10;                // points of a Latin hypercube
+    int replicates = 1;
+    std::uint64_t base_seed = 1;
+    int tick_count = 3000;           // ticks of a run, including the warm-up
+    int warmup_ticks = 0;
+    int check_interval = 30;         // ticks between looking at the number of infected subjects
+    unsigned thread_count = 1;
+};
+
+class Simulation;
+
+/**
+ * Runs all points of a sweep design on a number of threads and writes a table with one row per run: the
+ * parameters of its point, the peak number of infected subjects, the numbers at the end and the tick the
+ * epidemic died out on. A run stops as soon as no subject is infected and no immunity transition is
+ * pending, after that nothing changes anymore. A run that could not be continued from the snapshot of its
+ * warm-up is marked as failed.
+ */
+class Sweep
+{
+    public:
+        explicit Sweep(const SweepConfig& config);
+
+        const std::vector<Scenario>& points() const { return _points; }
+
+        //
+        // Returns false when a run failed, its row is still written
+        //
+        bool run(std::ostream& out);
+
+    private:
+        struct Result
+        {
+            int ticks = 0;          // ticks run, less than tick_count when the run stopped early
+            bool died_out = false;
+            bool failed = false;    // the warm-up snapshot could not be saved or restored
+            int peak_infected = 0, peak_tick = 0;
+            int infected = 0, immune = 0;
+        };
+
+        void make_points();
+        void warm_up(std::size_t snapshot);
+        void run_one(std::size_t run);
+        void run_until(Simulation& simulation, Result& result, int tick_count) const;
+        void write_results(std::ostream& out) const;
+
+        SweepConfig _config;
+        std::vector<Scenario> _points;
+
+        // Points with the same population share the snapshot of their warm-up
+        std::vector<std::size_t> _point_population;       // by point, index into _populations
+        std::vector<Scenario> _populations;
+        std::vector<std::vector<char>> _snapshots;        // by population and replicate
+        std::vector<Result> _warmups;                     // numbers of the warm-up, by population and replicate
+
+        std::vector<Result> _results;                     // by point and replicate
+};
+
+}
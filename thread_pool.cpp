@@ -0,0 +1,109 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "thread_pool.h"
+
+namespace corsim
+{
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+    for(unsigned i = 1; i < thread_count; i++)
+    {
+        _workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+
+    for(std::thread& t : _workers)
+    {
+        t.join();
+    }
+}
+
+unsigned ThreadPool::thread_count() const
+{
+    return _workers.size() + 1;
+}
+
+void ThreadPool::run(std::size_t task_count, const std::function<void(std::size_t)>& task)
+{
+    if(task_count == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _task_count = task_count;
+        _next_task = 0;
+        _busy = _workers.size();
+        _generation++;
+    }
+    _start.notify_all();
+
+    work();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this]{ return _busy == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::worker_loop()
+{
+    unsigned long seen = 0;
+
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _start.wait(lock, [&]{ return _stop || _generation != seen; });
+            if(_stop)
+            {
+                return;
+            }
+            seen = _generation;
+        }
+
+        work();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(--_busy == 0)
+        {
+            _done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::work()
+{
+    for(std::size_t k = _next_task++; k < _task_count; k = _next_task++)
+    {
+        (*_task)(k);
+    }
+}
+
+}
@@ -0,0 +1,65 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace corsim
+{
+
+/**
+ * A pool of worker threads that stays alive for the whole simulation, so a tick does
+ * not pay for starting threads. The thread calling run() takes part in the work.
+ *
+ * WASM builds without pthread support get no workers and run everything on the
+ * calling thread.
+ */
+class ThreadPool
+{
+    public:
+        explicit ThreadPool(unsigned thread_count);
+        ~ThreadPool();
+        unsigned thread_count() const;
+
+        //
+        // Calls task(k) for every k in [0, task_count) and returns when all calls are done.
+        // Tasks are handed out dynamically, they must not depend on the order they run in.
+        //
+        void run(std::size_t task_count, const std::function<void(std::size_t)>& task);
+
+    private:
+        void worker_loop();
+        void work();
+
+        std::vector<std::thread> _workers;
+        std::mutex _mutex;
+        std::condition_variable _start, _done;
+        const std::function<void(std::size_t)>* _task = nullptr;
+        std::size_t _task_count = 0;
+        std::atomic<std::size_t> _next_task{0};
+        unsigned long _generation = 0;
+        unsigned _busy = 0;
+        bool _stop = false;
+};
+
+}
@@ -0,0 +1,148 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "time_series.h"
+#include <algorithm>
+
+namespace corsim
+{
+
+TimeSeries::TimeSeries(std::size_t recent_capacity, std::size_t history_buckets) :
+    _recent_capacity{std::max<std::size_t>(recent_capacity, 1)}, _history_buckets{std::max<std::size_t>(history_buckets, 2)}
+{
+    _recent_times.reserve(_recent_capacity);
+    _recent_values.reserve(_recent_capacity);
+    _history.reserve(_history_buckets);
+}
+
+void TimeSeries::add(double time, double value)
+{
+    if(_recent_times.size() < _recent_capacity)
+    {
+        _recent_times.push_back(time);
+        _recent_values.push_back(value);
+        return;
+    }
+
+    // The oldest recent sample makes room for the new one
+    add_to_history(_recent_times[_recent_start], _recent_values[_recent_start]);
+    _recent_times[_recent_start] = time;
+    _recent_values[_recent_start] = value;
+    _recent_start = (_recent_start + 1) % _recent_capacity;
+}
+
+void TimeSeries::clear()
+{
+    _recent_times.clear();
+    _recent_values.clear();
+    _recent_start = 0;
+    _bucket_size = 1;
+    _history.clear();
+    _open = Bucket();
+}
+
+void TimeSeries::add_to_history(double time, double value)
+{
+    Bucket sample;
+    sample.min_time = sample.max_time = time;
+    sample.min_value = sample.max_value = value;
+    sample.count = 1;
+    merge(_open, sample);
+
+    if(_open.count < _bucket_size)
+    {
+        return;
+    }
+    _history.push_back(_open);
+    _open = Bucket();
+
+    if(_history.size() == _history_buckets)
+    {
+        // Halve the resolution, an odd bucket out stays on its own until it is filled up
+        std::size_t merged = 0;
+        for(std::size_t b = 0; b + 1 < _history.size(); b += 2)
+        {
+            Bucket bucket = _history[b];
+            merge(bucket, _history[b + 1]);
+            _history[merged++] = bucket;
+        }
+        if(_history.size() % 2 == 1)
+        {
+            _open = _history.back();
+        }
+        _history.resize(merged);
+        _bucket_size *= 2;
+    }
+}
+
+void TimeSeries::merge(Bucket& into, const Bucket& other)
+{
+    if(into.count == 0)
+    {
+        into = other;
+        return;
+    }
+
+    if(other.min_value < into.min_value)
+    {
+        into.min_time = other.min_time;
+        into.min_value = other.min_value;
+    }
+    if(other.max_value > into.max_value)
+    {
+        into.max_time = other.max_time;
+        into.max_value = other.max_value;
+    }
+    into.count += other.count;
+}
+
+void TimeSeries::append(const Bucket& bucket, std::vector<double>& times, std::vector<double>& values)
+{
+    if(bucket.count == 0)
+    {
+        return;
+    }
+
+    bool min_first = bucket.min_time <= bucket.max_time;
+    times.push_back(min_first ? bucket.min_time : bucket.max_time);
+    values.push_back(min_first ? bucket.min_value : bucket.max_value);
+    if(bucket.min_time != bucket.max_time)
+    {
+        times.push_back(min_first ? bucket.max_time : bucket.min_time);
+        values.push_back(min_first ? bucket.max_value : bucket.min_value);
+    }
+}
+
+void TimeSeries::points(std::vector<double>& times, std::vector<double>& values) const
+{
+    times.clear();
+    values.clear();
+
+    for(const Bucket& bucket : _history)
+    {
+        append(bucket, times, values);
+    }
+    append(_open, times, values);
+
+    for(std::size_t k = 0; k < _recent_times.size(); k++)
+    {
+        std::size_t r = (_recent_start + k) % _recent_times.size();
+        times.push_back(_recent_times[r]);
+        values.push_back(_recent_values[r]);
+    }
+}
+
+}
@@ -0,0 +1,69 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace corsim
+{
+
+/**
+ * A time series of bounded size for charts of runs of any length. The most recent samples are
+ * kept as they are in a ring buffer. Samples that drop out of it are decimated into buckets of
+ * equally many samples, of which only the lowest and the highest sample are kept, so peaks stay
+ * visible. When there are too many buckets, neighbouring buckets are merged, which halves the
+ * resolution of the history. A series never has more than recent_capacity + 2 * (history_buckets + 1)
+ * points, however many samples are added.
+ */
+class TimeSeries
+{
+    public:
+        TimeSeries(std::size_t recent_capacity = 240, std::size_t history_buckets = 120);
+
+        void add(double time, double value);
+        void clear();
+
+        //
+        // Replaces the contents of times and values with the points of the series, oldest first: the
+        // history with one or two points per bucket followed by the recent samples
+        //
+        void points(std::vector<double>& times, std::vector<double>& values) const;
+
+    private:
+        struct Bucket
+        {
+            double min_time, min_value;
+            double max_time, max_value;
+            std::size_t count = 0;      // samples in the bucket
+        };
+
+        void add_to_history(double time, double value);
+        static void merge(Bucket& into, const Bucket& other);
+        static void append(const Bucket& bucket, std::vector<double>& times, std::vector<double>& values);
+
+        std::size_t _recent_capacity;
+        std::vector<double> _recent_times, _recent_values; // ring buffer
+        std::size_t _recent_start = 0;                     // oldest recent sample once the ring is full
+
+        std::size_t _history_buckets;
+        std::size_t _bucket_size = 1;                      // samples per full bucket
+        std::vector<Bucket> _history;
+        Bucket _open;                                      // bucket being filled
+};
+
+}
@@ -0,0 +1,94 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "timer_wheel.h"
+
+namespace corsim
+{
+
+void TimerWheel::reset(int now)
+{
+    for(std::vector<Entry>& slot : _slots)
+    {
+        slot.clear();
+    }
+    _overflow.clear();
+    _now = now;
+    _size = 0;
+}
+
+void TimerWheel::schedule(std::size_t item, int tick)
+{
+    insert({item, tick});
+    _size++;
+}
+
+//
+// An entry goes to the lowest level on which its tick and the current tick only differ in the bits
+// of that level, so it is spread over the levels below exactly when the wheel gets there.
+//
+void TimerWheel::insert(const Entry& entry)
+{
+    unsigned difference = (unsigned)entry.tick ^ (unsigned)_now;
+    for(int level = 0; level < LEVELS; level++)
+    {
+        if((difference >> (SLOT_BITS * (level + 1))) == 0)
+        {
+            int slot = ((unsigned)entry.tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+            _slots[level * SLOTS + slot].push_back(entry);
+            return;
+        }
+    }
+    _overflow.push_back(entry);
+}
+
+void TimerWheel::cascade(std::vector<Entry>& entries)
+{
+    _cascading.swap(entries);
+    for(const Entry& entry : _cascading)
+    {
+        insert(entry);
+    }
+    _cascading.clear();
+}
+
+void TimerWheel::advance(std::vector<std::size_t>& due)
+{
+    _now++;
+    unsigned now = (unsigned)_now;
+
+    if((now & ((1u << (SLOT_BITS * LEVELS)) - 1)) == 0)
+    {
+        cascade(_overflow);
+    }
+    for(int level = LEVELS - 1; level > 0; level--)
+    {
+        if((now & ((1u << (SLOT_BITS * level)) - 1)) == 0)
+        {
+            cascade(_slots[level * SLOTS + ((now >> (SLOT_BITS * level)) & (SLOTS - 1))]);
+        }
+    }
+
+    std::vector<Entry>& slot = _slots[now & (SLOTS - 1)];
+    for(const Entry& entry : slot)
+    {
+        due.push_back(entry.item);
+    }
+    _size -= slot.size();
+    slot.clear();
+}
+
+}
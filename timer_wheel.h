@@ -0,0 +1,79 @@
+// Corona Simulation - basic simulation of a human transmissable virus
+// Copyright (C) 2020  wbrinksma
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace corsim
+{
+
+/**
+ * A hierarchical timer wheel with tick resolution. Items are scheduled for a tick and are
+ * handed back when the wheel advances to that tick, so the cost of a tick only depends on
+ * the number of items that are due and not on the number of items that are waiting.
+ *
+ * The first level has a slot for each of the next SLOTS ticks, every next level has a slot
+ * for SLOTS times as many ticks. Items further away than all levels wait in an overflow list.
+ * When the wheel passes the end of the slots of a level, the next slot of the level above is
+ * spread over the level below.
+ *
+ * An item can be scheduled more than once, it is handed back once for every time.
+ */
+class TimerWheel
+{
+    public:
+        //
+        // Drops all items and makes `now` the current tick
+        //
+        void reset(int now);
+
+        //
+        // Schedules `item` for `tick`, which has to be after the current tick
+        //
+        void schedule(std::size_t item, int tick);
+
+        //
+        // Moves the wheel one tick forward and appends the items scheduled for the new tick to `due`
+        //
+        void advance(std::vector<std::size_t>& due);
+
+        int now() const { return _now; }
+        std::size_t size() const { return _size; }
+
+    private:
+        struct Entry
+        {
+            std::size_t item;
+            int tick;
+        };
+
+        static const int SLOT_BITS = 8;
+        static const int SLOTS = 1 << SLOT_BITS;
+        static const int LEVELS = 3;
+
+        void insert(const Entry& entry);
+        void cascade(std::vector<Entry>& entries);
+
+        int _now = 0;
+        std::size_t _size = 0;
+        std::vector<std::vector<Entry>> _slots = std::vector<std::vector<Entry>>(LEVELS * SLOTS); // level * SLOTS + slot
+        std::vector<Entry> _overflow;
+        std::vector<Entry> _cascading;
+};
+
+}